@@ -0,0 +1,410 @@
+/*
+ * vim: set et ts=4 sw=4
+ *------------------------------------------------------------
+ *                                  ___ ___ _
+ *  ___ ___ ___ ___ ___       _____|  _| . | |_
+ * |  _| . |_ -|  _| . |     |     | . | . | '_|
+ * |_| |___|___|___|___|_____|_|_|_|___|___|_,_|
+ *                     |_____|
+ * ------------------------------------------------------------
+ * Copyright (c) 2021 Ross Bamford
+ * MIT License
+ *
+ * Software sprites (BOBs) with save-under, on an 8bpp canvas
+ * ------------------------------------------------------------
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "xosera_m68k_api.h"
+#include "bob.h"
+#include "dprint.h"
+
+#define BENCH_FRAMES    16
+#define BENCH_STEP      2               // BOBs added per bench round
+#define FRAME_TICKS     166             // 1/10ms in a 60Hz frame
+
+// Word-aligned rectangle on the canvas (columns in words, clipped)
+typedef struct {
+    int16_t     col;
+    int16_t     row;
+    uint16_t    words;
+    uint16_t    rows;
+} Rect;
+
+typedef struct {
+    const BobImage  *image;
+    int16_t     x;
+    int16_t     y;
+    uint8_t     z;
+    bool        visible;
+
+    // What's on the canvas now
+    bool        drawn;
+    Rect        saved;                  // Rectangle save holds (words == 0 if none)
+    int16_t     drawn_x;
+    int16_t     drawn_y;
+    uint16_t    *save;
+
+    bool        dirty;
+    Rect        next;
+} Bob;
+
+// Images from the bottom, save-under buffers from the top (reset by bob_init)
+static uint16_t pool[BOB_POOL_WORDS];
+static uint16_t pool_low = 0;
+static uint16_t pool_high = BOB_POOL_WORDS;
+
+static Bob bobs[BOB_MAX];
+static uint8_t num_bobs = 0;
+static uint8_t order[BOB_MAX];
+
+static uint16_t canvas_base;
+static uint16_t canvas_line;
+static uint16_t canvas_rows;
+
+void bob_init(uint16_t vram_base, uint16_t line_words, uint16_t rows) {
+    canvas_base = vram_base;
+    canvas_line = line_words;
+    canvas_rows = rows;
+    num_bobs = 0;
+    pool_high = BOB_POOL_WORDS;
+}
+
+static uint16_t *pool_alloc(uint16_t words, bool save) {
+    if (pool_high - pool_low < words) {
+        dprintf("BOB pool full (%d words free, %d wanted)\n", pool_high - pool_low, words);
+        return NULL;
+    }
+
+    if (save) {
+        pool_high -= words;
+        return &pool[pool_high];
+    }
+
+    uint16_t *p = &pool[pool_low];
+    pool_low += words;
+    return p;
+}
+
+bool bob_image_init(BobImage *image, const uint8_t *pixels, uint8_t width, uint8_t height) {
+    image->width = width;
+    image->height = height;
+
+    for (uint8_t shift = 0; shift < 2; shift++) {
+        uint8_t rw = (width + shift + 1) / 2;
+        uint16_t words = rw * height;
+
+        // Masks are bytes, so take half as many words (rounded up)
+        image->row_words[shift] = rw;
+        image->data[shift] = pool_alloc(words, false);
+        image->masks[shift] = (uint8_t *)pool_alloc((words + 1) / 2, false);
+
+        if (!image->data[shift] || !image->masks[shift]) {
+            return false;
+        }
+
+        for (uint8_t y = 0; y < height; y++) {
+            for (uint8_t w = 0; w < rw; w++) {
+                uint16_t word = 0;
+                uint8_t mask = 0;
+
+                // Pixel in the high byte, then the low byte (odd x starts in the low byte)
+                for (uint8_t half = 0; half < 2; half++) {
+                    int16_t px = w * 2 + half - shift;
+                    uint8_t pix = (px >= 0 && px < width) ? pixels[y * width + px] : 0;
+
+                    word = (word << 8) | pix;
+                    if (pix) {
+                        mask |= half ? 0x3 : 0xC;
+                    }
+                }
+
+                image->data[shift][y * rw + w] = word;
+                image->masks[shift][y * rw + w] = mask;
+            }
+        }
+    }
+
+    return true;
+}
+
+int8_t bob_add(const BobImage *image, uint8_t z) {
+    if (num_bobs == BOB_MAX) {
+        return -1;
+    }
+
+    uint16_t *save = pool_alloc(image->row_words[1] * image->height, true);
+    if (!save) {
+        return -1;
+    }
+
+    Bob *bob = &bobs[num_bobs];
+    bob->image = image;
+    bob->x = 0;
+    bob->y = 0;
+    bob->z = z;
+    bob->visible = false;
+    bob->drawn = false;
+    bob->saved.words = 0;
+    bob->save = save;
+
+    return num_bobs++;
+}
+
+void bob_move(int8_t id, int16_t x, int16_t y) {
+    bobs[id].x = x;
+    bobs[id].y = y;
+}
+
+void bob_show(int8_t id, bool visible) {
+    bobs[id].visible = visible;
+}
+
+// Canvas rectangle covered by image at x, y, clipped (words == 0 if off canvas)
+static Rect bob_rect(const BobImage *image, int16_t x, int16_t y) {
+    Rect r;
+    int16_t col = x >> 1;               // Arithmetic shift, so odd negative x still works
+    int16_t right = col + image->row_words[x & 1];
+    int16_t bottom = y + image->height;
+
+    r.col = col < 0 ? 0 : col;
+    r.row = y < 0 ? 0 : y;
+    right = right > (int16_t)canvas_line ? (int16_t)canvas_line : right;
+    bottom = bottom > (int16_t)canvas_rows ? (int16_t)canvas_rows : bottom;
+
+    r.words = right > r.col ? right - r.col : 0;
+    r.rows = bottom > r.row ? bottom - r.row : 0;
+    if (!r.rows) {
+        r.words = 0;
+    }
+
+    return r;
+}
+
+static inline bool overlaps(const Rect *a, const Rect *b) {
+    return a->words && b->words
+        && a->col < b->col + (int16_t)b->words && b->col < a->col + (int16_t)a->words
+        && a->row < b->row + (int16_t)b->rows && b->row < a->row + (int16_t)a->rows;
+}
+
+static inline uint16_t rect_addr(const Rect *r) {
+    return canvas_base + r->row * canvas_line + r->col;
+}
+
+// Sort ids in order[0..n) by key (insertion sort - n is small, and mostly sorted frame to frame)
+static void sort_order(uint8_t n, uint32_t (*key)(const Bob *)) {
+    for (uint8_t i = 1; i < n; i++) {
+        uint8_t id = order[i];
+        uint32_t k = key(&bobs[id]);
+        int8_t j = i - 1;
+
+        while (j >= 0 && key(&bobs[order[j]]) > k) {
+            order[j + 1] = order[j];
+            j--;
+        }
+        order[j + 1] = id;
+    }
+}
+
+static uint32_t saved_key(const Bob *bob) {
+    return rect_addr(&bob->saved);
+}
+
+static uint32_t next_key(const Bob *bob) {
+    return rect_addr(&bob->next);
+}
+
+static uint32_t draw_key(const Bob *bob) {
+    return ((uint32_t)bob->z << 16) | rect_addr(&bob->next);
+}
+
+static uint16_t draw_bob(const Bob *bob) {
+    const BobImage *image = bob->image;
+    const Rect *r = &bob->next;
+    uint8_t shift = bob->x & 1;
+    uint8_t rw = image->row_words[shift];
+    int16_t first_col = bob->x >> 1;
+    uint16_t skip_cols = r->col - first_col;
+    uint16_t skip_rows = r->row - bob->y;
+    uint16_t addr = rect_addr(r);
+    uint8_t cur_mask = 0xF;
+    uint16_t writes = 0;
+
+    for (uint16_t row = 0; row < r->rows; row++) {
+        const uint16_t *data = image->data[shift] + (skip_rows + row) * rw + skip_cols;
+        const uint8_t *masks = image->masks[shift] + (skip_rows + row) * rw + skip_cols;
+        bool addr_set = false;
+
+        for (uint16_t w = 0; w < r->words; w++) {
+            uint8_t mask = masks[w];
+
+            // Skip transparent words, picking the address back up after them
+            if (!mask) {
+                addr_set = false;
+                continue;
+            }
+            if (!addr_set) {
+                xm_setw(WR_ADDR, addr + w);
+                addr_set = true;
+            }
+            if (mask != cur_mask) {
+                xm_setbl(SYS_CTRL, mask);
+                cur_mask = mask;
+            }
+
+            xm_setw(DATA, data[w]);
+            writes++;
+        }
+
+        addr += canvas_line;
+    }
+
+    if (cur_mask != 0xF) {
+        xm_setbl(SYS_CTRL, 0xF);
+    }
+
+    return writes;
+}
+
+uint16_t bob_frame() {
+    uint8_t n = 0;
+    uint16_t writes = 0;
+
+    // What needs doing: anything that moved, appeared or vanished...
+    for (uint8_t i = 0; i < num_bobs; i++) {
+        Bob *bob = &bobs[i];
+
+        bob->next = bob->visible ? bob_rect(bob->image, bob->x, bob->y) : (Rect){ 0, 0, 0, 0 };
+        bob->dirty = bob->drawn != bob->visible
+            || (bob->visible && (bob->x != bob->drawn_x || bob->y != bob->drawn_y));
+    }
+
+    // ... and anything touching what did (its pixels get restored over, or saved under another)
+    bool changed = true;
+    while (changed) {
+        changed = false;
+
+        for (uint8_t i = 0; i < num_bobs; i++) {
+            if (bobs[i].dirty || !bobs[i].drawn) {
+                continue;
+            }
+
+            for (uint8_t j = 0; j < num_bobs; j++) {
+                if (bobs[j].dirty
+                        && (overlaps(&bobs[i].saved, &bobs[j].saved) || overlaps(&bobs[i].saved, &bobs[j].next))) {
+                    bobs[i].dirty = true;
+                    changed = true;
+                    break;
+                }
+            }
+        }
+    }
+
+    for (uint8_t i = 0; i < num_bobs; i++) {
+        if (bobs[i].dirty) {
+            order[n++] = i;
+        }
+    }
+
+    if (!n) {
+        return 0;
+    }
+
+    // 1. Restore
+    sort_order(n, saved_key);
+    for (uint8_t i = 0; i < n; i++) {
+        Bob *bob = &bobs[order[i]];
+
+        if (bob->drawn && bob->saved.words) {
+            xv_copy_rect((uint8_t *)bob->save, bob->saved.words * 2, canvas_base, canvas_line,
+                    bob->saved.col * 2, bob->saved.row, bob->saved.words * 2, bob->saved.rows, 8);
+            writes += bob->saved.words * bob->saved.rows;
+        }
+
+        bob->drawn = false;
+        bob->saved.words = 0;
+    }
+
+    // 2. Save
+    sort_order(n, next_key);
+    for (uint8_t i = 0; i < n; i++) {
+        Bob *bob = &bobs[order[i]];
+
+        if (bob->next.words) {
+            xv_copy_rect_from_vram(canvas_base, canvas_line, bob->next.col * 2, bob->next.row,
+                    bob->next.words * 2, bob->next.rows, 8, (uint8_t *)bob->save, bob->next.words * 2);
+            writes += bob->next.words * bob->next.rows;
+        }
+
+        bob->saved = bob->next;
+    }
+
+    // 3. Draw
+    sort_order(n, draw_key);
+    xm_setw(WR_INCR, 1);
+    for (uint8_t i = 0; i < n; i++) {
+        Bob *bob = &bobs[order[i]];
+
+        if (bob->visible) {
+            if (bob->next.words) {
+                writes += draw_bob(bob);
+            }
+
+            bob->drawn = true;
+            bob->drawn_x = bob->x;
+            bob->drawn_y = bob->y;
+        }
+    }
+
+    return writes;
+}
+
+void bob_bench(const BobImage *image, uint16_t vram_base, uint16_t line_words, uint16_t rows) {
+    uint16_t max_x = line_words * 2 - image->width;
+    uint16_t max_y = rows - image->height;
+    uint8_t capacity = 0;
+    uint32_t seed = 0x2545F491;
+
+    bob_init(vram_base, line_words, rows);
+
+    dprintf("\nBOBs (%dx%d), all moving every frame:\n", image->width, image->height);
+
+    while (num_bobs + BENCH_STEP <= BOB_MAX) {
+        for (uint8_t i = 0; i < BENCH_STEP; i++) {
+            int8_t id = bob_add(image, 0);
+            if (id < 0) {
+                break;
+            }
+            bob_show(id, true);
+        }
+
+        uint32_t ticks = 0;
+        uint16_t writes = 0;
+
+        for (uint8_t f = 0; f < BENCH_FRAMES; f++) {
+            for (uint8_t i = 0; i < num_bobs; i++) {
+                seed ^= seed << 13;
+                seed ^= seed >> 17;
+                seed ^= seed << 5;
+                bob_move(i, (seed & 0xFFFF) % max_x, (seed >> 16) % max_y);
+            }
+
+            uint16_t start = xm_getw(TIMER);
+            writes = bob_frame();
+            ticks += (uint16_t)(xm_getw(TIMER) - start);
+        }
+
+        uint32_t avg = ticks / BENCH_FRAMES;
+        dprintf("  %2d BOBs: %lu.%lums per frame, %d words\n", num_bobs, avg / 10, avg % 10, writes);
+
+        if (avg > FRAME_TICKS) {
+            break;
+        }
+        capacity = num_bobs;
+    }
+
+    dprintf("Capacity at 60Hz: %d BOBs (with nothing else to do)\n\n", capacity);
+}
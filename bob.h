@@ -0,0 +1,79 @@
+/*
+ * vim: set et ts=4 sw=4
+ *------------------------------------------------------------
+ *                                  ___ ___ _
+ *  ___ ___ ___ ___ ___       _____|  _| . | |_
+ * |  _| . |_ -|  _| . |     |     | . | . | '_|
+ * |_| |___|___|___|___|_____|_|_|_|___|___|_,_|
+ *                     |_____|
+ * ------------------------------------------------------------
+ * Copyright (c) 2021 Ross Bamford
+ * MIT License
+ *
+ * Software sprites (BOBs) with save-under, on an 8bpp canvas
+ *
+ * Images are stored pre-shifted for even and odd x, so drawing
+ * is always whole words, with a write mask per word for pixels
+ * that are transparent (colour 0). The mask goes through the
+ * SYS_CTRL nibble write mask, so there's no read-modify-write.
+ *
+ * Each bob_frame():
+ *
+ *   1. Restores the background under every BOB that changed
+ *   2. Saves the background under their new positions
+ *   3. Draws them, in z order, then VRAM address order
+ *
+ * Every save happens after all restores and before any draws,
+ * so save-under buffers only ever hold background, and the
+ * order restores happen in doesn't matter. A BOB that hasn't
+ * moved (and doesn't touch one that has) isn't touched at all,
+ * so VRAM writes are limited to the old and new rectangles of
+ * what moved. Each step works in address order, so writes are
+ * as sequential as they can be.
+ *
+ * The canvas is the background store, so anything drawn on it
+ * under a BOB is lost when the BOB moves off.
+ * ------------------------------------------------------------
+ */
+
+#if !defined(BOB_H)
+#define BOB_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define BOB_MAX             32
+#define BOB_POOL_WORDS      8192        // Image and save-under storage (words)
+
+typedef struct {
+    uint8_t     width;                  // Pixels
+    uint8_t     height;
+    uint8_t     row_words[2];           // Words per row, for even and odd x
+    uint16_t    *data[2];               // Pre-shifted pixel words, for even and odd x
+    uint8_t     *masks[2];              // Write mask per word (0 == all transparent)
+} BobImage;
+
+/* Set up for a canvas of rows lines, line_words words each, at vram_base. Removes all BOBs. */
+void bob_init(uint16_t vram_base, uint16_t line_words, uint16_t rows);
+
+/* Build a BOB image from width x height 8bpp pixels (0 is transparent). False if out of space. */
+bool bob_image_init(BobImage *image, const uint8_t *pixels, uint8_t width, uint8_t height);
+
+/* Add a (hidden) BOB. Higher z draws on top. Returns its id, or -1 if out of space. */
+int8_t bob_add(const BobImage *image, uint8_t z);
+
+void bob_move(int8_t id, int16_t x, int16_t y);
+void bob_show(int8_t id, bool visible);
+
+/* Restore, save and draw whatever changed. Returns VRAM words written (saves count as reads). */
+uint16_t bob_frame();
+
+/*
+ * Time bob_frame() with increasing numbers of copies of image,
+ * all moving every frame, and report how many fit in a 60Hz
+ * frame. Calls bob_init() on the given canvas (and leaves BOBs
+ * on it).
+ */
+void bob_bench(const BobImage *image, uint16_t vram_base, uint16_t line_words, uint16_t rows);
+
+#endif
@@ -0,0 +1,162 @@
+/*
+ * vim: set et ts=4 sw=4
+ *------------------------------------------------------------
+ *                                  ___ ___ _
+ *  ___ ___ ___ ___ ___       _____|  _| . | |_
+ * |  _| . |_ -|  _| . |     |     | . | . | '_|
+ * |_| |___|___|___|___|_____|_|_|_|___|___|_,_|
+ *                     |_____|
+ * ------------------------------------------------------------
+ * Copyright (c) 2021 Ross Bamford
+ * MIT License
+ *
+ * Runtime copper program builder
+ * ------------------------------------------------------------
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "xosera_m68k_api.h"
+#include "copper.h"
+#include "dprint.h"
+
+#define HALF_BASE(h)    (COP_RASTER_BASE + (h) * COP_RASTER_WORDS)
+
+extern volatile uint32_t vblank_count;
+
+// What's actually in each raster half of copper memory right now
+static uint32_t shadow[2][COP_MAX_INSTRS];
+// Program being presented, with local jumps resolved for the back half
+static uint32_t staged[COP_MAX_INSTRS];
+
+static uint8_t back_half = 1;
+static uint32_t switch_vblank = 0;
+static uint16_t last_writes = 0;
+
+void cop_reset(CopProg *prog) {
+    prog->len = 0;
+    prog->num_relocs = 0;
+    prog->overflow = false;
+}
+
+uint16_t cop_append(CopProg *prog, uint32_t instr) {
+    if (prog->len >= COP_MAX_INSTRS) {
+        prog->overflow = true;
+        return COP_MAX_INSTRS - 1;
+    }
+
+    prog->code[prog->len] = instr;
+    return prog->len++;
+}
+
+uint16_t cop_jump_local(CopProg *prog, uint16_t index) {
+    if (prog->num_relocs == COP_MAX_RELOCS) {
+        prog->overflow = true;
+        return COP_MAX_INSTRS - 1;
+    }
+
+    uint16_t at = cop_append(prog, COP_JUMP(index * 2));
+
+    if (!prog->overflow) {
+        prog->relocs[prog->num_relocs++] = at;
+    }
+
+    return at;
+}
+
+bool cop_validate(const CopProg *prog) {
+    if (prog->overflow) {
+        dprintf("Copper program overflowed (max %d instructions)\n", COP_MAX_INSTRS);
+        return false;
+    }
+
+    if (prog->len == 0 || prog->code[prog->len - 1] != COP_END()) {
+        dprintf("Copper program must finish with COP_END\n");
+        return false;
+    }
+
+    for (int i = 0; i < prog->num_relocs; i++) {
+        if (((prog->code[prog->relocs[i]] >> 17) & 0x3FF) >= prog->len) {
+            dprintf("Copper program jumps past its end (instruction %d)\n", prog->relocs[i]);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void cop_raster_init() {
+    xm_setw(XR_ADDR, XR_COPPER_MEM + COP_RASTER_BASE);
+
+    for (int h = 0; h < 2; h++) {
+        for (int i = 0; i < COP_MAX_INSTRS; i++) {
+            shadow[h][i] = COP_END();
+            xm_setw(XR_DATA, COP_END() >> 16);
+            xm_setw(XR_DATA, COP_END() & 0xFFFF);
+        }
+    }
+
+    xm_setw(XR_ADDR, XR_COPPER_MEM + COP_RASTER_ENTRY);
+    xm_setw(XR_DATA, COP_JUMP(HALF_BASE(0)) >> 16);
+    xm_setw(XR_DATA, COP_JUMP(HALF_BASE(0)) & 0xFFFF);
+
+    back_half = 1;
+    switch_vblank = vblank_count;
+}
+
+bool cop_raster_present(const CopProg *prog) {
+    if (!cop_validate(prog)) {
+        return false;
+    }
+
+    uint16_t base = HALF_BASE(back_half);
+    uint32_t *current = shadow[back_half];
+
+    memcpy(staged, prog->code, prog->len * sizeof(uint32_t));
+    for (int i = 0; i < prog->num_relocs; i++) {
+        staged[prog->relocs[i]] += (uint32_t)base << 16;
+    }
+
+    // Back half was live until the last switch - let that frame finish
+    while (vblank_count == switch_vblank) {
+        // busywait...
+    }
+
+    uint16_t writes = 0;
+    uint16_t i = 0;
+
+    while (i < prog->len) {
+        if (staged[i] == current[i]) {
+            i++;
+            continue;
+        }
+
+        // Changed run - one address write, then auto-increment
+        xm_setw(XR_ADDR, XR_COPPER_MEM + base + i * 2);
+        writes++;
+
+        while (i < prog->len && staged[i] != current[i]) {
+            xm_setw(XR_DATA, staged[i] >> 16);
+            xm_setw(XR_DATA, staged[i] & 0xFFFF);
+            current[i] = staged[i];
+            writes += 2;
+            i++;
+        }
+    }
+
+    // Single word write, copper picks it up at the start of next frame
+    xmem_setw(XR_COPPER_MEM + COP_RASTER_ENTRY, COP_JUMP(base) >> 16);
+    writes++;
+
+    switch_vblank = vblank_count;
+    back_half ^= 1;
+    last_writes = writes;
+
+    return true;
+}
+
+uint16_t cop_raster_last_writes() {
+    return last_writes;
+}
@@ -0,0 +1,123 @@
+/*
+ * vim: set et ts=4 sw=4
+ *------------------------------------------------------------
+ *                                  ___ ___ _
+ *  ___ ___ ___ ___ ___       _____|  _| . | |_
+ * |  _| . |_ -|  _| . |     |     | . | . | '_|
+ * |_| |___|___|___|___|_____|_|_|_|___|___|_,_|
+ *                     |_____|
+ * ------------------------------------------------------------
+ * Copyright (c) 2021 Ross Bamford
+ * MIT License
+ *
+ * Runtime copper program builder, with double-buffered
+ * raster programs in copper memory.
+ *
+ * Programs are built in RAM with the cop_* append functions,
+ * then presented with cop_raster_present(). That uploads only
+ * the words that differ from what's already in the back half
+ * of copper memory, then flips the raster entry jump to it.
+ * The copper reads that jump once at the start of each frame,
+ * so the switch always takes effect cleanly at vblank.
+ * ------------------------------------------------------------
+ */
+
+#if !defined(COPPER_H)
+#define COPPER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "xosera_m68k_api.h"
+
+#define COP_MEM_WORDS       2048
+
+/*
+ * Copper memory layout (word addresses):
+ *
+ *   COP_PAL_ENTRY:     JUMP <palette sequence, or COP_RASTER_ENTRY>
+ *   COP_RASTER_ENTRY:  JUMP <active raster half>
+ *   COP_PAL_BASE:      palette sequences (see copper_palette.h)
+ *   COP_RASTER_BASE:   raster half 0, then raster half 1
+ */
+#define COP_PAL_ENTRY       0x0000
+#define COP_RASTER_ENTRY    0x0002
+#define COP_PAL_BASE        0x0004
+#define COP_RASTER_BASE     0x0320
+#define COP_RASTER_WORDS    0x0270      // Per half
+#define COP_PAL_WORDS       (COP_RASTER_BASE - COP_PAL_BASE)
+
+#define COP_MAX_INSTRS      (COP_RASTER_WORDS / 2)
+#define COP_MAX_RELOCS      8
+
+typedef struct {
+    uint32_t    code[COP_MAX_INSTRS];
+    uint16_t    len;                    // Instructions appended so far
+    uint8_t     num_relocs;
+    uint16_t    relocs[COP_MAX_RELOCS]; // Instructions that JUMP within this program
+    bool        overflow;               // Set if anything failed to append
+} CopProg;
+
+void     cop_reset(CopProg *prog);
+uint16_t cop_append(CopProg *prog, uint32_t instr);
+
+// Builder shorthand - all return the index of the appended instruction
+static inline uint16_t cop_wait_v(CopProg *prog, uint16_t v_pos) {
+    return cop_append(prog, COP_WAIT_V(v_pos));
+}
+
+static inline uint16_t cop_wait_hv(CopProg *prog, uint16_t h_pos, uint16_t v_pos) {
+    return cop_append(prog, COP_WAIT_HV(h_pos, v_pos));
+}
+
+static inline uint16_t cop_skip_v(CopProg *prog, uint16_t v_pos) {
+    return cop_append(prog, COP_SKIP_V(v_pos));
+}
+
+static inline uint16_t cop_skip_hv(CopProg *prog, uint16_t h_pos, uint16_t v_pos) {
+    return cop_append(prog, COP_SKIP_HV(h_pos, v_pos));
+}
+
+// xreg is a register number (e.g. XR_PA_GFX_CTRL), not a name like COP_MOVER takes
+static inline uint16_t cop_mover(CopProg *prog, uint8_t xreg, uint16_t val) {
+    return cop_append(prog, 0x60000000 | XB_((uint32_t)xreg, 23, 16) | val);
+}
+
+static inline uint16_t cop_movep(CopProg *prog, uint8_t color_num, uint16_t rgb) {
+    return cop_append(prog, COP_MOVEP(rgb, color_num));
+}
+
+static inline uint16_t cop_movec(CopProg *prog, uint16_t cop_addr, uint16_t val) {
+    return cop_append(prog, COP_MOVEC(val, cop_addr));
+}
+
+// Absolute jump to a copper word address (outside this program)
+static inline uint16_t cop_jump(CopProg *prog, uint16_t cop_addr) {
+    return cop_append(prog, COP_JUMP(cop_addr));
+}
+
+static inline uint16_t cop_end(CopProg *prog) {
+    return cop_append(prog, COP_END());
+}
+
+// Jump to instruction index within this program (relocated on upload)
+uint16_t cop_jump_local(CopProg *prog, uint16_t index);
+
+// Replace the 16-bit value of a previously appended MOVER/MOVEP/MOVEC
+static inline void cop_patch_value(CopProg *prog, uint16_t index, uint16_t val) {
+    prog->code[index] = (prog->code[index] & 0xFFFF0000) | val;
+}
+
+// True if the program is complete and fits a raster half
+bool cop_validate(const CopProg *prog);
+
+// Fill both halves with empty programs and point the raster entry at half 0
+void cop_raster_init();
+
+// Upload (changes only) to the back half, and switch to it at next vblank
+bool cop_raster_present(const CopProg *prog);
+
+// Copper words written by the last cop_raster_present()
+uint16_t cop_raster_last_writes();
+
+#endif
@@ -0,0 +1,224 @@
+/*
+ * vim: set et ts=4 sw=4
+ *------------------------------------------------------------
+ *                                  ___ ___ _
+ *  ___ ___ ___ ___ ___       _____|  _| . | |_
+ * |  _| . |_ -|  _| . |     |     | . | . | '_|
+ * |_| |___|___|___|___|_____|_|_|_|___|___|_,_|
+ *                     |_____|
+ * ------------------------------------------------------------
+ * Copyright (c) 2021 Ross Bamford
+ * MIT License
+ *
+ * Copper-driven palette animation compiler
+ * ------------------------------------------------------------
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "xosera_m68k_api.h"
+#include "copper.h"
+#include "copper_palette.h"
+#include "dprint.h"
+
+// Simulated palette state while compiling (one sequence at a time)
+static uint16_t cur[256];
+static uint16_t next[256];
+static uint16_t final[256];
+static uint16_t fade_from[256];
+static uint8_t  known[32];
+static uint8_t  touched[32];
+
+#define BIT_SET(map, i)     (map[(i) >> 3] |= (1 << ((i) & 7)))
+#define BIT_TEST(map, i)    (map[(i) >> 3] & (1 << ((i) & 7)))
+
+static uint16_t lerp_rgb(uint16_t from, uint16_t to, uint16_t step, uint16_t steps) {
+    uint16_t result = 0;
+
+    for (int shift = 0; shift < 12; shift += 4) {
+        int f = (from >> shift) & 0xF;
+        int t = (to >> shift) & 0xF;
+
+        result |= ((f + ((t - f) * step) / steps) & 0xF) << shift;
+    }
+
+    return result;
+}
+
+static void apply_ops(const PalAnim *anim, uint16_t frame) {
+    for (int o = 0; o < anim->num_ops; o++) {
+        const PalOp *op = &anim->ops[o];
+        uint16_t rate = op->rate ? op->rate : 1;
+
+        if (frame < op->start || op->last < op->first) {
+            continue;
+        }
+
+        switch (op->type) {
+        case PAL_OP_CYCLE:
+            if ((op->length == 0 || frame < op->start + op->length) && ((frame - op->start) % rate) == 0) {
+                uint16_t carry = next[op->last];
+
+                for (int i = op->last; i > op->first; i--) {
+                    next[i] = next[i - 1];
+                    BIT_SET(touched, i);
+                }
+
+                next[op->first] = carry;
+                BIT_SET(touched, op->first);
+            }
+            break;
+
+        case PAL_OP_FADE:
+            if (frame == op->start) {
+                for (int i = op->first; i <= op->last; i++) {
+                    fade_from[i] = next[i] & PAL_RGB_MASK;
+                }
+            }
+
+            if (frame < op->start + rate) {
+                uint16_t step = frame - op->start + 1;
+
+                for (int i = op->first; i <= op->last; i++) {
+                    uint16_t target = op->colors ? op->colors[i - op->first] : op->value;
+
+                    next[i] = (next[i] & PAL_BLEND_MASK) | lerp_rgb(fade_from[i], target, step, rate);
+                    BIT_SET(touched, i);
+                }
+            }
+            break;
+
+        case PAL_OP_BLEND:
+            if (frame == op->start) {
+                for (int i = op->first; i <= op->last; i++) {
+                    next[i] = (next[i] & PAL_RGB_MASK) | (op->value & PAL_BLEND_MASK);
+                    BIT_SET(touched, i);
+                }
+            }
+            break;
+        }
+    }
+}
+
+static inline bool entry_changed(int i, bool against_final) {
+    return next[i] != cur[i]
+        || (against_final && next[i] != final[i])
+        || (BIT_TEST(touched, i) && !BIT_TEST(known, i));
+}
+
+static inline void emit(uint32_t instr) {
+    xm_setw(XR_DATA, instr >> 16);
+    xm_setw(XR_DATA, instr & 0xFFFF);
+}
+
+/*
+ * Simulate the whole sequence, returning the number of copper words
+ * it needs. If do_emit is set, also write it to copper memory.
+ *
+ * A looping sequence's frame 0 runs after its last frame as well as
+ * at the very start, so it must also write anything that differs
+ * from the final state (which needs a previous run to work out).
+ */
+static uint16_t run(const PalAnim *anim, uint16_t cop_addr, uint16_t tail_addr, bool do_emit, bool have_final) {
+    uint16_t frames = anim->frames ? anim->frames : 1;
+    uint16_t addr = cop_addr + 2;
+
+    if (anim->base) {
+        memcpy(cur, anim->base, sizeof(cur));
+        memset(known, 0xFF, sizeof(known));
+    } else {
+        memset(cur, 0, sizeof(cur));
+        memset(known, 0, sizeof(known));
+    }
+
+    if (do_emit) {
+        xm_setw(XR_ADDR, XR_COPPER_MEM + cop_addr);
+        emit(COP_JUMP(addr));
+    }
+
+    for (uint16_t f = 0; f < frames; f++) {
+        bool against_final = have_final && f == 0;
+        uint16_t changes = 0;
+
+        memcpy(next, cur, sizeof(next));
+        memset(touched, 0, sizeof(touched));
+        apply_ops(anim, f);
+
+        for (int i = 0; i < 256; i++) {
+            if (entry_changed(i, against_final)) {
+                changes++;
+            }
+        }
+
+        uint16_t frame_words = (changes + 2) * 2;
+        uint16_t next_addr = addr + frame_words;
+
+        if (f == frames - 1 && anim->loop) {
+            next_addr = cop_addr + 2;
+        }
+
+        if (do_emit) {
+            for (int i = 0; i < 256; i++) {
+                if (entry_changed(i, against_final)) {
+                    emit(COP_MOVEP(next[i], i));
+                }
+            }
+
+            emit(COP_MOVEC(COP_JUMP(next_addr) >> 16, cop_addr));
+            emit(COP_JUMP(tail_addr));
+        }
+
+        for (int i = 0; i < 32; i++) {
+            known[i] |= touched[i];
+        }
+
+        memcpy(cur, next, sizeof(cur));
+        addr += frame_words;
+    }
+
+    if (!anim->loop) {
+        // Park frame - one-shot sequences stay here until switched
+        if (do_emit) {
+            emit(COP_JUMP(tail_addr));
+        }
+        addr += 2;
+    }
+
+    return addr - cop_addr;
+}
+
+bool cop_pal_compile(const PalAnim *anim, uint16_t cop_addr, uint16_t max_words, uint16_t tail_addr, PalSeq *seq) {
+    if (anim->loop) {
+        run(anim, cop_addr, tail_addr, false, false);
+        memcpy(final, cur, sizeof(final));
+    }
+
+    uint16_t words = run(anim, cop_addr, tail_addr, false, anim->loop);
+
+    if (words > max_words) {
+        dprintf("Palette sequence needs %d copper words, only %d available\n", words, max_words);
+        return false;
+    }
+
+    run(anim, cop_addr, tail_addr, true, anim->loop);
+
+    seq->cursor = cop_addr;
+    seq->first_frame = cop_addr + 2;
+    seq->words = words;
+
+    return true;
+}
+
+void cop_pal_start(const PalSeq *seq) {
+    // Sequence isn't running yet, so its cursor is safe to rewind
+    xmem_setw(XR_COPPER_MEM + seq->cursor, COP_JUMP(seq->first_frame) >> 16);
+    xmem_setw(XR_COPPER_MEM + COP_PAL_ENTRY, COP_JUMP(seq->cursor) >> 16);
+}
+
+void cop_pal_stop(uint16_t tail_addr) {
+    // Writes the whole instruction, so this also sets up the entry initially
+    xm_setw(XR_ADDR, XR_COPPER_MEM + COP_PAL_ENTRY);
+    emit(COP_JUMP(tail_addr));
+}
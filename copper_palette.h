@@ -0,0 +1,90 @@
+/*
+ * vim: set et ts=4 sw=4
+ *------------------------------------------------------------
+ *                                  ___ ___ _
+ *  ___ ___ ___ ___ ___       _____|  _| . | |_
+ * |  _| . |_ -|  _| . |     |     | . | . | '_|
+ * |_| |___|___|___|___|_____|_|_|_|___|___|_,_|
+ *                     |_____|
+ * ------------------------------------------------------------
+ * Copyright (c) 2021 Ross Bamford
+ * MIT License
+ *
+ * Copper-driven palette animation compiler
+ *
+ * Turns a palette animation description (cycles, fades, blend
+ * bit changes) into a chain of per-frame copper programs. Each
+ * frame program writes only the colour entries that changed
+ * since the previous frame (with MOVEP), then advances its own
+ * sequence cursor (with MOVEC) and jumps to the rest of the
+ * copper list. The CPU only gets involved when switching from
+ * one sequence to another.
+ *
+ * Copper memory layout assumed here:
+ *
+ *   COP_PAL_ENTRY:  JUMP <active sequence cursor, or tail>
+ *   <sequence>:     JUMP <frame N>     ; cursor, patched by copper
+ *                   <frame 0>          ; MOVEP..., MOVEC cursor, JUMP tail
+ *                   ...
+ *                   <frame N>
+ *                   <park>             ; JUMP tail (one-shot sequences)
+ * ------------------------------------------------------------
+ */
+
+#if !defined(COPPER_PALETTE_H)
+#define COPPER_PALETTE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "copper.h"
+
+// Palette operation types
+#define PAL_OP_CYCLE        0       // Rotate entries [first..last] up by one every `rate` frames
+#define PAL_OP_FADE         1       // Fade RGB of entries [first..last] to target over `rate` frames
+#define PAL_OP_BLEND        2       // Set blend bits of entries [first..last] to `value` (high nybble)
+
+#define PAL_BLEND_MASK      0xF000
+#define PAL_RGB_MASK        0x0FFF
+
+typedef struct {
+    uint8_t         type;           // One of PAL_OP_*
+    uint8_t         first;          // First colour entry affected
+    uint8_t         last;           // Last colour entry affected (inclusive)
+    uint8_t         rate;           // CYCLE: frames per step, FADE: length in frames (min 1)
+    uint16_t        start;          // Frame on which this op begins
+    uint16_t        length;         // CYCLE: frames the cycle runs for (0 == to end of sequence)
+    uint16_t        value;          // FADE: target RGB (if colors is NULL), BLEND: blend bits
+    const uint16_t  *colors;        // FADE: per-entry target RGB table, or NULL to use value
+} PalOp;
+
+typedef struct {
+    const uint16_t  *base;          // Palette in COLOR_MEM when sequence starts, or NULL if unknown
+    uint16_t        frames;         // Number of frames in the sequence (min 1)
+    bool            loop;           // Loop back to frame 0, or park on the last frame
+    uint8_t         num_ops;
+    const PalOp     *ops;
+} PalAnim;
+
+typedef struct {
+    uint16_t        cursor;         // Copper address of the sequence cursor jump
+    uint16_t        first_frame;    // Copper address of frame 0
+    uint16_t        words;          // Total copper words used by the sequence
+} PalSeq;
+
+/*
+ * Compile anim into copper memory at cop_addr, using no more than
+ * max_words. Every frame program ends by jumping to tail_addr.
+ *
+ * Returns false (and leaves seq untouched) if the sequence does
+ * not fit.
+ */
+bool cop_pal_compile(const PalAnim *anim, uint16_t cop_addr, uint16_t max_words, uint16_t tail_addr, PalSeq *seq);
+
+/* Rewind seq to frame 0 and point the copper entry at it */
+void cop_pal_start(const PalSeq *seq);
+
+/* Point the copper entry straight at tail_addr (no palette animation) */
+void cop_pal_stop(uint16_t tail_addr);
+
+#endif
@@ -17,6 +17,8 @@
  */
 
 #include <stdarg.h>
+#include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include "dprint.h"
 
@@ -33,8 +35,66 @@ void dputc(char c)
 #endif
 }
 
+/*
+ * Ring-buffered output. While buffered, dprint/dprintf only copy into
+ * the ring, and dprint_drain() sends it a few characters at a time.
+ * Messages that don't fit are dropped whole, and counted.
+ */
+#define DPRINT_RING_SIZE 4096                   // Must be a power of two
+#define DPRINT_RING_MASK (DPRINT_RING_SIZE - 1)
+
+static char     dprint_ring[DPRINT_RING_SIZE];
+static uint16_t dprint_head;                    // Next write
+static uint16_t dprint_tail;                    // Next send
+static bool     dprint_is_buffered;
+static uint32_t dprint_dropped_count;
+static uint32_t dprint_dropped_noted;
+
+static uint16_t ring_free(void)
+{
+    return DPRINT_RING_SIZE - 1 - ((dprint_head - dprint_tail) & DPRINT_RING_MASK);
+}
+
+static uint16_t expanded_len(const char * str)
+{
+    uint16_t len = 0;
+    register char c;
+    while ((c = *str++) != '\0')
+    {
+        len += (c == '\n') ? 2 : 1;
+    }
+    return len;
+}
+
+static void ring_put(const char * str)
+{
+    if (expanded_len(str) > ring_free())
+    {
+        dprint_dropped_count++;
+        return;
+    }
+
+    register char c;
+    while ((c = *str++) != '\0')
+    {
+        if (c == '\n')
+        {
+            dprint_ring[dprint_head] = '\r';
+            dprint_head              = (dprint_head + 1) & DPRINT_RING_MASK;
+        }
+        dprint_ring[dprint_head] = c;
+        dprint_head              = (dprint_head + 1) & DPRINT_RING_MASK;
+    }
+}
+
 void dprint(const char * str)
 {
+    if (dprint_is_buffered)
+    {
+        ring_put(str);
+        return;
+    }
+
     register char c;
     while ((c = *str++) != '\0')
     {
@@ -56,3 +116,45 @@ void dprintf(const char * fmt, ...)
     va_end(args);
 }
 
+void dprint_buffered(bool enable)
+{
+    if (!enable)
+    {
+        dprint_flush();
+    }
+    dprint_is_buffered = enable;
+}
+
+bool dprint_drain(uint16_t max_chars)
+{
+    if (dprint_head == dprint_tail && dprint_dropped_noted != dprint_dropped_count)
+    {
+        // Caught up - say what was lost, so gaps in the log are obvious
+        char note[48];
+        snprintf(note,
+                 sizeof(note),
+                 "[%lu messages dropped]\n",
+                 (unsigned long)(dprint_dropped_count - dprint_dropped_noted));
+        dprint_dropped_noted = dprint_dropped_count;
+        ring_put(note);
+    }
+
+    while (max_chars-- && dprint_head != dprint_tail)
+    {
+        dputc(dprint_ring[dprint_tail]);
+        dprint_tail = (dprint_tail + 1) & DPRINT_RING_MASK;
+    }
+
+    return dprint_head != dprint_tail;
+}
+
+void dprint_flush(void)
+{
+    while (dprint_drain(0xFFFF))
+        ;
+}
+
+uint32_t dprint_dropped(void)
+{
+    return dprint_dropped_count;
+}
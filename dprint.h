@@ -10,11 +10,21 @@
  * Copyright (c) 2021 Xark
  * MIT License
  *
- * Debug printing (direct to UART)
+ * Debug printing (direct to UART, or ring-buffered)
  * ------------------------------------------------------------
  */
 
+#include <stdbool.h>
+#include <stdint.h>
+
 void dputc(char c);
 void dprint(const char * str);
 void dprintf(const char * fmt, ...);
 
+// Buffered mode: dprint/dprintf only append to a RAM ring, which
+// dprint_drain() sends a few characters at a time (e.g. from idle time).
+void     dprint_buffered(bool enable);        // Disabling flushes first
+bool     dprint_drain(uint16_t max_chars);    // True if more remains
+void     dprint_flush(void);                  // Blocking, until the ring is empty
+uint32_t dprint_dropped(void);                // Messages dropped as the ring was full
+
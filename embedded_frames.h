@@ -0,0 +1,34 @@
+/*
+ * vim: set et ts=4 sw=4
+ *------------------------------------------------------------
+ *                                  ___ ___ _
+ *  ___ ___ ___ ___ ___       _____|  _| . | |_
+ * |  _| . |_ -|  _| . |     |     | . | . | '_|
+ * |_| |___|___|___|___|_____|_|_|_|___|___|_,_|
+ *                     |_____|
+ * ------------------------------------------------------------
+ * Copyright (c) 2021 Ross Bamford
+ * MIT License
+ *
+ * Frames linked into the binary (EMBEDDED_FRAMES builds)
+ *
+ * The definitions are generated by the converter's -c mode, and
+ * the Makefile builds them in when EMBED is set, e.g.
+ *
+ *   make EMBED=assets/spincube/frames.c
+ * ------------------------------------------------------------
+ */
+
+#if !defined(EMBEDDED_FRAMES_H)
+#define EMBEDDED_FRAMES_H
+
+#include <stdint.h>
+
+extern const uint16_t embedded_frame_count;
+extern const uint32_t embedded_frame_size;      // Bytes per frame
+extern const uint8_t  embedded_frames[];        // All frames, back to back (embedded_frame_size apart)
+extern const uint16_t embedded_palette[16];     // RGB444, for colour frames
+extern const uint32_t embedded_loading_size;    // 0 if no loading image
+extern const uint8_t  embedded_loading[];       // Loading image (PCX) as-is
+
+#endif
@@ -0,0 +1,187 @@
+/*
+ * vim: set et ts=4 sw=4
+ *------------------------------------------------------------
+ *                                  ___ ___ _
+ *  ___ ___ ___ ___ ___       _____|  _| . | |_
+ * |  _| . |_ -|  _| . |     |     | . | . | '_|
+ * |_| |___|___|___|___|_____|_|_|_|___|___|_,_|
+ *                     |_____|
+ * ------------------------------------------------------------
+ * Copyright (c) 2021 Ross Bamford
+ * MIT License
+ *
+ * Vblank-driven frame scheduler
+ * ------------------------------------------------------------
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "xosera_m68k_api.h"
+#include "frame_sched.h"
+#include "pb_present.h"
+#include "dprint.h"
+
+// Maintained by the vblank handler
+extern volatile uint32_t vblank_count;
+extern volatile uint16_t vblank_timer;
+
+typedef struct {
+    SchedTaskFunc   func;
+    void            *ctx;
+    uint16_t        cost;           // Slowest slice seen, in 1/10ms
+    bool            more;           // Still has work this frame
+} SchedTask;
+
+static SchedTask tasks[SCHED_MAX_TASKS];
+static uint8_t num_tasks = 0;
+static uint8_t next_task = 0;
+
+static uint8_t frame_vblanks = 1;
+static uint32_t present_vblank = 0;     // vblank_count the next frame should appear at
+static SchedStats stats;
+
+static inline uint16_t timer_now() {
+    return xm_getw(TIMER);
+}
+
+/* Ticks left before vblank_count reaches until_vblank (0 if already there) */
+static uint16_t ticks_left(uint32_t until_vblank) {
+    uint32_t count = vblank_count;
+    uint16_t since = timer_now() - vblank_timer;
+
+    if (count >= until_vblank) {
+        return 0;
+    }
+
+    uint32_t left = (until_vblank - count) * stats.frame_ticks;
+    return left > since ? left - since : 0;
+}
+
+/* Run one task slice that fits in the time left, returning false if none did */
+static bool run_one_task(uint32_t until_vblank) {
+    uint16_t left = ticks_left(until_vblank);
+
+    for (uint8_t n = 0; n < num_tasks; n++) {
+        SchedTask *task = &tasks[next_task];
+
+        if (++next_task == num_tasks) {
+            next_task = 0;
+        }
+
+        if (task->more && task->cost < left) {
+            uint16_t start = timer_now();
+            task->more = task->func(task->ctx);
+            uint16_t took = timer_now() - start;
+
+            if (took > task->cost) {
+                task->cost = took;
+            }
+
+            stats.task_ticks += took;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static void run_idle(uint32_t until_vblank) {
+    while (vblank_count < until_vblank) {
+        if (!run_one_task(until_vblank)) {
+            uint16_t start = timer_now();
+            uint32_t count = vblank_count;
+
+            while (vblank_count == count) {
+                // Nothing fits - wait for the vblank
+            }
+
+            stats.idle_ticks += (uint16_t)(timer_now() - start);
+        }
+    }
+}
+
+void sched_init(uint8_t vblanks_per_frame) {
+    frame_vblanks = vblanks_per_frame ? vblanks_per_frame : 1;
+
+    // Measure vblank period (vblank_timer is set by the handler)
+    uint32_t count = vblank_count;
+    while (vblank_count == count);
+    uint16_t first = vblank_timer;
+    count = vblank_count;
+    while (vblank_count == count);
+
+    stats.frame_ticks = vblank_timer - first;
+    present_vblank = vblank_count + frame_vblanks;
+}
+
+bool sched_add_task(SchedTaskFunc func, void *ctx, uint16_t est_ticks) {
+    if (num_tasks == SCHED_MAX_TASKS) {
+        return false;
+    }
+
+    tasks[num_tasks].func = func;
+    tasks[num_tasks].ctx = ctx;
+    tasks[num_tasks].cost = est_ticks;
+    tasks[num_tasks].more = true;
+    num_tasks++;
+
+    return true;
+}
+
+/* Keep busy until the pending PB frame has been displayed */
+static void wait_for_flip() {
+    run_idle(pb_ready_at);
+
+    while (pb_pending()) {
+        // Only if the handler was held off - shouldn't normally wait here
+    }
+}
+
+uint16_t sched_begin_frame() {
+    uint16_t addr;
+
+    // Only fails with two buffers and one pending, which its flip frees up
+    while (!pb_try_acquire(&addr)) {
+        pb_note_stall();
+        wait_for_flip();
+    }
+
+    return addr;
+}
+
+void sched_present() {
+    if (pb_pending()) {
+        wait_for_flip();
+    }
+
+    if (vblank_count >= present_vblank) {
+        // Missed the slot - show at the very next vblank instead
+        uint32_t behind = vblank_count - present_vblank;
+
+        stats.late++;
+        stats.dropped += behind / frame_vblanks + 1;
+        present_vblank = vblank_count + 1;
+    }
+
+    pb_try_submit(present_vblank);
+    present_vblank += frame_vblanks;
+    stats.frames++;
+
+    for (uint8_t i = 0; i < num_tasks; i++) {
+        tasks[i].more = true;
+    }
+}
+
+const SchedStats *sched_stats() {
+    return &stats;
+}
+
+void sched_report() {
+    dprintf("Frames: %lu (late: %lu, dropped: %lu) @ %d vblanks/frame, %d.%d ms/vblank\n",
+            stats.frames, stats.late, stats.dropped, frame_vblanks,
+            stats.frame_ticks / 10, stats.frame_ticks % 10);
+    dprintf("Idle time: %lu.%lu ms in tasks, %lu.%lu ms waiting\n",
+            stats.task_ticks / 10, stats.task_ticks % 10,
+            stats.idle_ticks / 10, stats.idle_ticks % 10);
+}
@@ -0,0 +1,58 @@
+/*
+ * vim: set et ts=4 sw=4
+ *------------------------------------------------------------
+ *                                  ___ ___ _
+ *  ___ ___ ___ ___ ___       _____|  _| . | |_
+ * |  _| . |_ -|  _| . |     |     | . | . | '_|
+ * |_| |___|___|___|___|_____|_|_|_|___|___|_,_|
+ *                     |_____|
+ * ------------------------------------------------------------
+ * Copyright (c) 2021 Ross Bamford
+ * MIT License
+ *
+ * Vblank-driven frame scheduler
+ *
+ * Presents a frame every N vblanks, and spends any time the CPU
+ * has to wait (for a PB buffer, or for the last frame to go up)
+ * running registered idle tasks instead of spinning. Each
+ * task does a small slice of work per call; the scheduler times
+ * them with XM_TIMER and only starts one if its slowest slice
+ * so far still fits before the vblank it's waiting for.
+ * ------------------------------------------------------------
+ */
+
+#if !defined(FRAME_SCHED_H)
+#define FRAME_SCHED_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define SCHED_MAX_TASKS     4
+
+// Do one slice of work. Return true if there's more to do this frame.
+typedef bool (*SchedTaskFunc)(void *ctx);
+
+typedef struct {
+    uint32_t    frames;             // Frames presented
+    uint32_t    late;               // Presents that missed their vblank
+    uint32_t    dropped;            // Frame slots skipped because of late presents
+    uint32_t    task_ticks;         // 1/10ms spent in idle tasks
+    uint32_t    idle_ticks;         // 1/10ms spent waiting with nothing to run
+    uint16_t    frame_ticks;        // Measured 1/10ms per vblank
+} SchedStats;
+
+void sched_init(uint8_t vblanks_per_frame);
+
+// est_ticks is a first guess at the task's slice time (1/10ms), refined as it runs
+bool sched_add_task(SchedTaskFunc func, void *ctx, uint16_t est_ticks);
+
+// Get a PB buffer to draw the next frame into
+uint16_t sched_begin_frame();
+
+// Queue the drawn buffer for the next frame slot
+void sched_present();
+
+const SchedStats *sched_stats();
+void sched_report();
+
+#endif
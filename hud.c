@@ -0,0 +1,158 @@
+/*
+ * vim: set et ts=4 sw=4
+ *------------------------------------------------------------
+ *                                  ___ ___ _
+ *  ___ ___ ___ ___ ___       _____|  _| . | |_
+ * |  _| . |_ -|  _| . |     |     | . | . | '_|
+ * |_| |___|___|___|___|_____|_|_|_|___|___|_,_|
+ *                     |_____|
+ * ------------------------------------------------------------
+ * Copyright (c) 2021 Ross Bamford
+ * MIT License
+ *
+ * On-screen text HUD, shown through tile mode
+ * ------------------------------------------------------------
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "xosera_m68k_api.h"
+#include "copper.h"
+#include "hud.h"
+
+#define GFX_MODE_HUD        MAKE_GFX_CTRL(HUD_COLBASE, 0, 0, 0, 1, 1)   // 1bpp tiles, Hx2 + Vx2
+#define GFX_MODE_HUD_BLANK  MAKE_GFX_CTRL(HUD_COLBASE, 1, 0, 0, 1, 1)
+#define HUD_LINES           16                                          // 8 line glyphs, Vx2
+
+// Glyph N in the font is character N of this string
+static const char hud_chars[] = " 0123456789.:DFMOPRSW";
+
+static const uint8_t hud_font[][8] = {
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },     // ' '
+    { 0x3C, 0x66, 0x6E, 0x76, 0x66, 0x66, 0x3C, 0x00 },     // '0'
+    { 0x18, 0x38, 0x18, 0x18, 0x18, 0x18, 0x7E, 0x00 },     // '1'
+    { 0x3C, 0x66, 0x06, 0x0C, 0x30, 0x60, 0x7E, 0x00 },     // '2'
+    { 0x3C, 0x66, 0x06, 0x1C, 0x06, 0x66, 0x3C, 0x00 },     // '3'
+    { 0x0C, 0x1C, 0x3C, 0x6C, 0x7E, 0x0C, 0x0C, 0x00 },     // '4'
+    { 0x7E, 0x60, 0x7C, 0x06, 0x06, 0x66, 0x3C, 0x00 },     // '5'
+    { 0x1C, 0x30, 0x60, 0x7C, 0x66, 0x66, 0x3C, 0x00 },     // '6'
+    { 0x7E, 0x06, 0x0C, 0x18, 0x30, 0x30, 0x30, 0x00 },     // '7'
+    { 0x3C, 0x66, 0x66, 0x3C, 0x66, 0x66, 0x3C, 0x00 },     // '8'
+    { 0x3C, 0x66, 0x66, 0x3E, 0x06, 0x0C, 0x38, 0x00 },     // '9'
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x18, 0x18, 0x00 },     // '.'
+    { 0x00, 0x18, 0x18, 0x00, 0x00, 0x18, 0x18, 0x00 },     // ':'
+    { 0x78, 0x6C, 0x66, 0x66, 0x66, 0x6C, 0x78, 0x00 },     // 'D'
+    { 0x7E, 0x60, 0x60, 0x7C, 0x60, 0x60, 0x60, 0x00 },     // 'F'
+    { 0x63, 0x77, 0x7F, 0x6B, 0x63, 0x63, 0x63, 0x00 },     // 'M'
+    { 0x3C, 0x66, 0x66, 0x66, 0x66, 0x66, 0x3C, 0x00 },     // 'O'
+    { 0x7C, 0x66, 0x66, 0x7C, 0x60, 0x60, 0x60, 0x00 },     // 'P'
+    { 0x7C, 0x66, 0x66, 0x7C, 0x6C, 0x66, 0x66, 0x00 },     // 'R'
+    { 0x3C, 0x66, 0x60, 0x3C, 0x06, 0x66, 0x3C, 0x00 },     // 'S'
+    { 0x63, 0x63, 0x63, 0x6B, 0x7F, 0x77, 0x63, 0x00 },     // 'W'
+};
+
+static uint16_t hud_tilemap;
+static uint16_t shadow[HUD_COLS];       // What's in VRAM
+static uint16_t want[HUD_COLS];         // What should be
+
+static uint8_t glyph(char c) {
+    for (uint8_t i = 0; hud_chars[i]; i++) {
+        if (hud_chars[i] == c) {
+            return i;
+        }
+    }
+
+    return 0;
+}
+
+void hud_init(uint16_t tilemap) {
+    hud_tilemap = tilemap;
+
+    // Two rows of 8 pixels per word
+    xm_setw(XR_ADDR, XR_TILE_MEM + HUD_FONT_BASE);
+    for (uint16_t g = 0; g < sizeof(hud_font) / sizeof(hud_font[0]); g++) {
+        for (int row = 0; row < 8; row += 2) {
+            xm_setw(XR_DATA, (hud_font[g][row] << 8) | hud_font[g][row + 1]);
+        }
+    }
+
+    xmem_setw(XR_COLOR_MEM + HUD_COLBASE + 0x0, 0x0000);
+    xmem_setw(XR_COLOR_MEM + HUD_COLBASE + 0xE, 0x0FF0);
+    xmem_setw(XR_COLOR_MEM + HUD_COLBASE + 0xF, 0x0FFF);
+
+    xm_setw(WR_INCR, 1);
+    xm_setw(WR_ADDR, tilemap);
+    for (int i = 0; i < HUD_COLS; i++) {
+        shadow[i] = want[i] = 0;
+        xm_setw(DATA, 0);
+    }
+}
+
+void hud_build(CopProg *prog, uint16_t tilemap, uint16_t top) {
+    // Set up while the line before is still blank
+    cop_wait_v(prog, top - 1);
+    cop_mover(prog, XR_PA_TILE_CTRL, MAKE_TILE_CTRL(HUD_FONT_BASE, 0, 8));
+    cop_mover(prog, XR_PA_LINE_LEN, HUD_COLS);
+    cop_mover(prog, XR_PA_HV_SCROLL, 0);
+    cop_mover(prog, XR_PA_LINE_ADDR, tilemap);
+    cop_wait_v(prog, top);
+    cop_mover(prog, XR_PA_GFX_CTRL, GFX_MODE_HUD);
+    cop_wait_v(prog, top + HUD_LINES);
+    cop_mover(prog, XR_PA_GFX_CTRL, GFX_MODE_HUD_BLANK);
+}
+
+void hud_text(uint8_t col, uint8_t attr, const char *str) {
+    while (*str && col < HUD_COLS) {
+        want[col++] = (attr << 8) | glyph(*str++);
+    }
+}
+
+void hud_number(uint8_t col, uint8_t width, uint8_t frac_digits, uint32_t value) {
+    int8_t point = frac_digits ? width - 1 - frac_digits : -1;
+
+    for (int8_t i = width - 1; i >= 0; i--) {
+        char c;
+
+        if (i == point) {
+            c = '.';
+        } else {
+            c = '0' + value % 10;
+            value /= 10;
+        }
+
+        if (col + i < HUD_COLS) {
+            want[col + i] = (HUD_ATTR_TEXT << 8) | glyph(c);
+        }
+    }
+}
+
+uint16_t hud_update(uint16_t max_writes) {
+    uint16_t writes = 0;
+    int8_t last = -2;
+
+    for (int8_t i = 0; i < HUD_COLS; i++) {
+        if (want[i] == shadow[i]) {
+            continue;
+        }
+
+        // Runs of changed tiles only need the address once
+        uint16_t cost = (i == last + 1) ? 1 : 2;
+
+        if (writes + cost > max_writes) {
+            break;
+        }
+
+        // WR_INCR is left at 1 by everything else too
+        if (cost == 2) {
+            xm_setw(WR_ADDR, hud_tilemap + i);
+        }
+
+        xm_setw(DATA, want[i]);
+        shadow[i] = want[i];
+        writes += cost;
+        last = i;
+    }
+
+    return writes;
+}
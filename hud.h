@@ -0,0 +1,53 @@
+/*
+ * vim: set et ts=4 sw=4
+ *------------------------------------------------------------
+ *                                  ___ ___ _
+ *  ___ ___ ___ ___ ___       _____|  _| . | |_
+ * |  _| . |_ -|  _| . |     |     | . | . | '_|
+ * |_| |___|___|___|___|_____|_|_|_|___|___|_,_|
+ *                     |_____|
+ * ------------------------------------------------------------
+ * Copyright (c) 2021 Ross Bamford
+ * MIT License
+ *
+ * On-screen text HUD, shown through tile mode
+ *
+ * A small 8x8 font is uploaded to tile memory once, and a single
+ * row of text lives as a tilemap in VRAM. The copper switches a
+ * band of playfield A into 1bpp tile mode to show it. Text is
+ * kept in a RAM shadow, and hud_update() writes only the tiles
+ * that differ from what's in VRAM, up to a per-call limit.
+ * ------------------------------------------------------------
+ */
+
+#if !defined(HUD_H)
+#define HUD_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "copper.h"
+
+#define HUD_COLS            40          // 320 wide with Hx2
+#define HUD_FONT_BASE       0x1000      // Tile memory offset (1K word aligned), clear of 0x0000-0x0FFF
+#define HUD_COLBASE         0xE0        // Palette entries 0xE0-0xEF
+#define HUD_ATTR_TEXT       0xF0        // White on black
+#define HUD_ATTR_LABEL      0xE0        // Yellow on black
+
+// Upload font and palette, and clear the text row at tilemap (HUD_COLS words of VRAM).
+// Palette entries are overwritten by a full palette load, so call after that.
+void hud_init(uint16_t tilemap);
+
+// Append the tile mode band showing tilemap (top is a native scanline, multiple of 16)
+void hud_build(CopProg *prog, uint16_t tilemap, uint16_t top);
+
+// Set text at col in the shadow (only the characters in the HUD font show)
+void hud_text(uint8_t col, uint8_t attr, const char *str);
+
+// Set a right-aligned, zero-padded number, with an optional decimal point
+void hud_number(uint8_t col, uint8_t width, uint8_t frac_digits, uint32_t value);
+
+// Write up to max_writes words to bring VRAM up to date. Returns words written.
+uint16_t hud_update(uint16_t max_writes);
+
+#endif
@@ -6,6 +6,8 @@
 
         include "xosera_m68k_defs.inc"
 
+XRQ_MASK        equ     63              ; NOTE: Must match XRQ_SIZE - 1 in xr_queue.h!
+
 install_intr::
                 movem.l D0-D7/A0-A6,-(A7)
 
@@ -39,27 +41,51 @@ remove_intr::
 
 ; interrupt routine
 Xosera_intr:
-                movem.l D0-D2/A0,-(A7)
+                movem.l D0-D3/A0-A1,-(A7)
                 move.l  #XM_BASEADDR,A0         ; Get Xosera base addr
                 movep.w XM_XR_ADDR(A0),D2       ; save aux_addr value
 
-                ; move.w  pa_gfx_ctrl,D0          ; Get requested PA GFX_CTRL
-                ; move.w  #XR_PA_GFX_CTRL,D1      ; And set in Xosera
-                ; movep.w D1,XM_XR_ADDR(A0)
-                ; movep.w D0,XM_XR_DATA(A0)                
+                movep.w XM_TIMER(A0),D0         ; Note timer at vblank...
+                move.w  D0,vblank_timer         ; ... for frame budgeting
 
-                move.w  pb_gfx_ctrl,D0          ; Get requested PB GFX_CTRL
-                move.w  #XR_PB_GFX_CTRL,D1      ; And set in Xosera
-                movep.w D1,XM_XR_ADDR(A0)
-                movep.w D0,XM_XR_DATA(A0)                
+                moveq.l #0,D0
+                move.b  xrq_tail,D0             ; Drain deferred XR writes...
+                move.b  xrq_head,D1             ; ... up to what's committed now
+                lea.l   xrq_entries,A1
+
+.DRAIN
+                cmp.b   D0,D1                   ; Caught up?
+                beq.s   .DRAINED
+
+                move.w  D0,D3                   ; Entries are 4 bytes...
+                lsl.w   #2,D3
+                move.l  0(A1,D3.w),D3           ; ... XR address high, value low
+                movep.l D3,XM_XR_ADDR(A0)       ; Set XR_ADDR and XR_DATA in one go
 
-                tst.b   pb_flip_needed          ; Buffer flip needed?
+                addq.b  #1,D0
+                and.b   #XRQ_MASK,D0
+                bra.s   .DRAIN
+
+.DRAINED
+                move.b  D0,xrq_tail             ; Hand the slots back
+
+                moveq.l #0,D0
+                move.b  pb_ready,D0             ; Completed PB buffer waiting?
+                cmp.b   #$FF,D0
                 beq.s   .DONE                   ; Done if not...
 
-                move.w  back_pb_buf,D0          ; Else, swap the buffers...
-                move.w  current_pb_buf,back_pb_buf
-                move.w  D0,current_pb_buf
-                clr.b   pb_flip_needed          ; ... and reset the flag.
+                move.l  vblank_count,D1         ; Is it due by the end of this vblank?
+                addq.l  #1,D1
+                cmp.l   pb_ready_at,D1
+                bcs.s   .DONE                   ; Not yet...
+
+                move.b  D0,pb_displayed         ; Else, it's the displayed buffer now...
+                move.b  #$FF,pb_ready           ; ... and the ready slot is free again
+                move.l  D1,pb_flip_vblank
+
+                lea.l   pb_buf_addr,A1          ; Look up its VRAM address
+                add.w   D0,D0
+                move.w  0(A1,D0.w),D0
 
                 move.w  #XR_PB_DISP_ADDR,D1     ; Inform Xosera about the change
                 movep.w D1,XM_XR_ADDR(A0)
@@ -70,7 +96,7 @@ Xosera_intr:
                 move.b  D0,XM_TIMER+2(A0)       ; ... and clear out the pending interrupts
 
                 movep.w D2,XM_XR_ADDR(A0)       ; restore aux_addr
-                movem.l (A7)+,D0-D2/A0
+                movem.l (A7)+,D0-D3/A0-A1
 
                 addi.l  #1,vblank_count         ; Increment vblank counter (used for waits)
 
@@ -0,0 +1,349 @@
+/*
+ * vim: set et ts=4 sw=4
+ *------------------------------------------------------------
+ *                                  ___ ___ _
+ *  ___ ___ ___ ___ ___       _____|  _| . | |_
+ * |  _| . |_ -|  _| . |     |     | . | . | '_|
+ * |_| |___|___|___|___|_____|_|_|_|___|___|_,_|
+ *                     |_____|
+ * ------------------------------------------------------------
+ * Copyright (c) 2021 Ross Bamford
+ * MIT License
+ *
+ * Procedural effects for the PA canvas
+ * ------------------------------------------------------------
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "xosera_m68k_api.h"
+#include "pa_fx.h"
+#include "pa_fx_tables.h"
+#include "dprint.h"
+
+#define CELLS_W         (PAFX_LINE_WORDS / 2)       // Fire and tunnel cells across (two words each)
+#define FIRE_DECAY      1
+#define STAR_SPEED      4
+#define NO_ROW          -1
+
+#define BENCH_PASSES    4
+#define FRAME_TICKS     166             // 1/10ms in a 60Hz frame
+
+typedef struct {
+    int8_t      x;
+    int8_t      y;
+    uint8_t     z;
+    int16_t     old_row;                // Where it was drawn (NO_ROW if not)
+    uint8_t     old_col;
+    int16_t     new_row;                // Where it goes this pass
+    uint8_t     new_col;
+    uint8_t     color;
+} Star;
+
+static const char *effect_names[PAFX_NUM_EFFECTS] = { "plasma", "fire", "starfield", "tunnel" };
+
+static uint8_t fx_effect;
+static uint16_t fx_base;
+static uint16_t fx_rows;
+static uint16_t fx_row;                 // Next row to draw
+static uint8_t fx_time;                 // Passes so far
+static uint32_t fx_seed = 0x2545F491;
+
+static uint16_t row_buf[PAFX_LINE_WORDS];
+
+// Per effect state
+static uint8_t plasma_cols[PAFX_LINE_WORDS];
+static uint8_t heat[PAFX_MAX_ROWS / 2 + 2][CELLS_W];
+static Star stars[PAFX_STARS];
+
+uint32_t pafx_rand() {
+    fx_seed ^= fx_seed << 13;
+    fx_seed ^= fx_seed >> 17;
+    fx_seed ^= fx_seed << 5;
+    return fx_seed;
+}
+
+static inline uint16_t pixel_word(uint8_t color) {
+    return (color << 8) | color;
+}
+
+static inline void write_row(uint16_t row) {
+    xv_copy_to_vram(row_buf, fx_base + row * PAFX_LINE_WORDS, PAFX_LINE_WORDS * 2);
+}
+
+/* Plasma - sum of sines, across (per pass) plus down (per row) */
+static void plasma_pass() {
+    uint8_t t = fx_time;
+
+    for (uint16_t x = 0; x < PAFX_LINE_WORDS; x++) {
+        plasma_cols[x] = pafx_sin[(uint8_t)(x * 2 + t * 3)] + pafx_sin[(uint8_t)(x * 5 - t * 2)];
+    }
+}
+
+static void plasma_row(uint16_t y) {
+    uint8_t t = fx_time;
+    uint8_t down = pafx_sin[(uint8_t)(y * 3 + t * 4)] + pafx_sin[(uint8_t)(y + pafx_sin[(uint8_t)(y + t)])];
+
+    for (uint16_t x = 0; x < PAFX_LINE_WORDS; x++) {
+        row_buf[x] = pixel_word((uint8_t)(plasma_cols[x] + down) >> 1);
+    }
+
+    write_row(y);
+}
+
+/* Fire - each cell averages the ones below it, cooling as it rises, from a random bottom row */
+static void fire_pass() {
+    uint16_t cells_h = fx_rows / 2;
+
+    for (uint8_t r = 0; r < 2; r++) {
+        for (uint16_t x = 0; x < CELLS_W; x++) {
+            heat[cells_h + r][x] = (pafx_rand() & 0x100) ? 255 : 0;
+        }
+    }
+}
+
+static void fire_row(uint16_t y) {
+    // Second line of a cell is the same as the first
+    if (y & 1) {
+        write_row(y);
+        return;
+    }
+
+    uint8_t *cell = heat[y / 2];
+    const uint8_t *below = heat[y / 2 + 1];
+    const uint8_t *below2 = heat[y / 2 + 2];
+
+    for (uint16_t x = 0; x < CELLS_W; x++) {
+        uint16_t left = below[x ? x - 1 : x];
+        uint16_t right = below[x < CELLS_W - 1 ? x + 1 : x];
+        uint16_t h = (left + below[x] + right + below2[x]) >> 2;
+
+        h = h > FIRE_DECAY ? h - FIRE_DECAY : 0;
+        cell[x] = h;
+        row_buf[x * 2] = row_buf[x * 2 + 1] = pixel_word(h > 127 ? 127 : h);
+    }
+
+    write_row(y);
+}
+
+/* Starfield - stars fly out from the centre, with perspective from a table */
+static void star_spawn(Star *star) {
+    uint32_t r = pafx_rand();
+
+    star->x = r;
+    star->y = r >> 8;
+    star->z = 96 + ((r >> 16) & 0x7F);
+}
+
+static void stars_pass() {
+    for (uint8_t i = 0; i < PAFX_STARS; i++) {
+        Star *star = &stars[i];
+
+        star->old_row = star->new_row;
+        star->old_col = star->new_col;
+
+        if (star->z < PAFX_STAR_NEAR + STAR_SPEED) {
+            star_spawn(star);
+        } else {
+            star->z -= STAR_SPEED;
+        }
+
+        uint16_t scale = pafx_star_scale[star->z];
+        int16_t sx = PAFX_LINE_WORDS + ((star->x * (int32_t)scale) >> 8);
+        int16_t sy = fx_rows / 2 + ((star->y * (int32_t)scale) >> 8);
+
+        if (sx < 0 || sx >= PAFX_LINE_WORDS * 2 || sy < 0 || sy >= (int16_t)fx_rows) {
+            star->new_row = NO_ROW;
+            star->z = 0;                // Respawn next pass
+        } else {
+            star->new_row = sy;
+            star->new_col = sx >> 1;
+            star->color = 127 - (star->z >> 1);
+        }
+    }
+}
+
+// Rows first..last-1: rub out stars that left, then draw the ones that arrived
+static uint32_t stars_band(uint16_t first, uint16_t last) {
+    uint32_t words = 0;
+
+    xm_setw(WR_INCR, 0);
+
+    for (uint8_t i = 0; i < PAFX_STARS; i++) {
+        Star *star = &stars[i];
+
+        if (star->old_row >= (int16_t)first && star->old_row < (int16_t)last
+                && (star->old_row != star->new_row || star->old_col != star->new_col)) {
+            xm_setw(WR_ADDR, fx_base + star->old_row * PAFX_LINE_WORDS + star->old_col);
+            xm_setw(DATA, 0);
+            words++;
+        }
+    }
+
+    for (uint8_t i = 0; i < PAFX_STARS; i++) {
+        Star *star = &stars[i];
+
+        if (star->new_row >= (int16_t)first && star->new_row < (int16_t)last) {
+            xm_setw(WR_ADDR, fx_base + star->new_row * PAFX_LINE_WORDS + star->new_col);
+            xm_setw(DATA, pixel_word(star->color));
+            words++;
+        }
+    }
+
+    xm_setw(WR_INCR, 1);                // Everything else expects it left at 1
+    return words * 2;
+}
+
+/* Tunnel - texture looked up by angle and depth, the quadrant tables mirrored round the centre */
+static void tunnel_row(uint16_t y) {
+    if (y & 1) {
+        write_row(y);
+        return;
+    }
+
+    uint16_t cy = y / 2;
+    uint16_t half_h = fx_rows / 4;
+    bool top = cy < half_h;
+    uint16_t qy = top ? half_h - 1 - cy : cy - half_h;
+    uint8_t spin = fx_time * 2;
+    uint8_t move = fx_time * 4;
+
+    if (qy >= PAFX_TUNNEL_QH) {
+        qy = PAFX_TUNNEL_QH - 1;
+    }
+
+    const uint8_t *angle = &pafx_tunnel_angle[qy * PAFX_TUNNEL_QW];
+    const uint8_t *depth = &pafx_tunnel_depth[qy * PAFX_TUNNEL_QW];
+
+    for (uint16_t q = 0; q < PAFX_TUNNEL_QW; q++) {
+        uint8_t d = depth[q];
+
+        // Left half runs from the edge in, right half from the centre out
+        uint16_t left = (PAFX_TUNNEL_QW - 1 - q) * 2;
+        uint16_t right = (PAFX_TUNNEL_QW + q) * 2;
+
+        if (d == 255) {
+            row_buf[left] = row_buf[left + 1] = row_buf[right] = row_buf[right + 1] = 0;
+            continue;
+        }
+
+        uint8_t a = angle[q];
+        uint8_t v = d + move;
+        uint8_t light = (255 - d) >> 2;         // Brighter towards the mouth
+
+        // Angles: right-bottom a, left-bottom 128 - a, left-top 128 + a, right-top -a
+        uint8_t al = (top ? 128 + a : 128 - a) + spin;
+        uint8_t ar = (top ? -a : a) + spin;
+
+        row_buf[left] = row_buf[left + 1] = pixel_word(((al ^ v) & 0x3F) + light);
+        row_buf[right] = row_buf[right + 1] = pixel_word(((ar ^ v) & 0x3F) + light);
+    }
+
+    write_row(y);
+}
+
+static void start_pass() {
+    switch (fx_effect) {
+    case PAFX_PLASMA:
+        plasma_pass();
+        break;
+    case PAFX_FIRE:
+        fire_pass();
+        break;
+    case PAFX_STARFIELD:
+        stars_pass();
+        break;
+    }
+}
+
+void pafx_init(uint8_t effect, uint16_t vram_base, uint16_t rows) {
+    fx_effect = effect;
+    fx_base = vram_base;
+    fx_rows = rows > PAFX_MAX_ROWS ? PAFX_MAX_ROWS : rows & ~1;
+    fx_row = 0;
+    fx_time = 0;
+
+    for (uint16_t y = 0; y < sizeof(heat) / sizeof(heat[0]); y++) {
+        for (uint16_t x = 0; x < CELLS_W; x++) {
+            heat[y][x] = 0;
+        }
+    }
+
+    for (uint8_t i = 0; i < PAFX_STARS; i++) {
+        star_spawn(&stars[i]);
+        stars[i].z = 32 + (pafx_rand() & 0xBF);     // Spread out to start with
+        stars[i].new_row = NO_ROW;
+    }
+
+    xv_vram_fill(vram_base, rows * PAFX_LINE_WORDS, 0);
+    start_pass();
+}
+
+uint32_t pafx_step(uint16_t rows) {
+    uint32_t pixels = 0;
+
+    while (rows) {
+        uint16_t band = fx_rows - fx_row;
+
+        if (band > rows) {
+            band = rows;
+        }
+
+        if (fx_effect == PAFX_STARFIELD) {
+            pixels += stars_band(fx_row, fx_row + band);
+        } else {
+            for (uint16_t y = fx_row; y < fx_row + band; y++) {
+                switch (fx_effect) {
+                case PAFX_PLASMA:
+                    plasma_row(y);
+                    break;
+                case PAFX_FIRE:
+                    fire_row(y);
+                    break;
+                case PAFX_TUNNEL:
+                    tunnel_row(y);
+                    break;
+                }
+            }
+            pixels += band * PAFX_LINE_WORDS * 2;
+        }
+
+        fx_row += band;
+        rows -= band;
+
+        if (fx_row == fx_rows) {
+            fx_row = 0;
+            fx_time++;
+            start_pass();
+        }
+    }
+
+    return pixels;
+}
+
+void pafx_bench(uint16_t vram_base, uint16_t rows) {
+    dprintf("\nPA effects, %d passes of %d rows each:\n", BENCH_PASSES, rows);
+
+    for (uint8_t e = 0; e < PAFX_NUM_EFFECTS; e++) {
+        pafx_init(e, vram_base, rows);
+
+        uint32_t pixels = 0;
+        uint16_t start = xm_getw(TIMER);
+
+        for (uint8_t p = 0; p < BENCH_PASSES; p++) {
+            pixels += pafx_step(fx_rows);
+        }
+
+        uint32_t ticks = (uint16_t)(xm_getw(TIMER) - start);
+        if (!ticks) {
+            ticks = 1;
+        }
+
+        // Starfield only writes where stars are, so rows per frame is the useful number there
+        dprintf("  %-10s %6lu pixels, %3lu rows per 60Hz frame\n", effect_names[e],
+                pixels * FRAME_TICKS / ticks, (uint32_t)BENCH_PASSES * fx_rows * FRAME_TICKS / ticks);
+    }
+
+    dprintf("\n");
+}
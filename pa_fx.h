@@ -0,0 +1,60 @@
+/*
+ * vim: set et ts=4 sw=4
+ *------------------------------------------------------------
+ *                                  ___ ___ _
+ *  ___ ___ ___ ___ ___       _____|  _| . | |_
+ * |  _| . |_ -|  _| . |     |     | . | . | '_|
+ * |_| |___|___|___|___|_____|_|_|_|___|___|_,_|
+ *                     |_____|
+ * ------------------------------------------------------------
+ * Copyright (c) 2021 Ross Bamford
+ * MIT License
+ *
+ * Procedural effects for the 8bpp PA canvas (320 pixels, 160
+ * words a line): plasma, fire, starfield and tunnel.
+ *
+ * Effects draw a pass over the canvas a few rows at a time,
+ * top to bottom, so a frame only has to pay for the rows it
+ * has time for. The animation moves on at the start of each
+ * pass. Rows are built in RAM from the tables in
+ * pa_fx_tables.c and written out as whole words, in address
+ * order. Plasma is two pixels per word; fire and tunnel are
+ * 4x2 pixel cells. The starfield only touches the words its
+ * stars move from and to, a band of rows at a time.
+ *
+ * Colours are 0-127 (0 is black / background).
+ * ------------------------------------------------------------
+ */
+
+#if !defined(PA_FX_H)
+#define PA_FX_H
+
+#include <stdint.h>
+
+#define PAFX_PLASMA         0
+#define PAFX_FIRE           1
+#define PAFX_STARFIELD      2
+#define PAFX_TUNNEL         3
+#define PAFX_NUM_EFFECTS    4
+
+#define PAFX_LINE_WORDS     160
+#define PAFX_MAX_ROWS       168
+#define PAFX_STARS          96
+
+/* Start effect on the canvas (rows lines, even, at vram_base), clearing it */
+void pafx_init(uint8_t effect, uint16_t vram_base, uint16_t rows);
+
+/* Draw the next rows of the current pass. Returns pixels written. */
+uint32_t pafx_step(uint16_t rows);
+
+/* xorshift32 - cheap random numbers without touching Xosera */
+uint32_t pafx_rand();
+
+/*
+ * Time a few passes of each effect and print the pixels per
+ * 60Hz frame it can sustain (with nothing else to do). Leaves
+ * the last effect on the canvas.
+ */
+void pafx_bench(uint16_t vram_base, uint16_t rows);
+
+#endif
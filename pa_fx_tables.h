@@ -0,0 +1,45 @@
+/*
+ * vim: set et ts=4 sw=4
+ *------------------------------------------------------------
+ *                                  ___ ___ _
+ *  ___ ___ ___ ___ ___       _____|  _| . | |_
+ * |  _| . |_ -|  _| . |     |     | . | . | '_|
+ * |_| |___|___|___|___|_____|_|_|_|___|___|_,_|
+ *                     |_____|
+ * ------------------------------------------------------------
+ * Copyright (c) 2021 Ross Bamford
+ * MIT License
+ *
+ * Lookup tables for the PA effects
+ *
+ * pa_fx_tables.c is generated at build time by
+ * utils/gen_fx_tables.c (see the Makefile), which also
+ * includes this header for the sizes.
+ * ------------------------------------------------------------
+ */
+
+#if !defined(PA_FX_TABLES_H)
+#define PA_FX_TABLES_H
+
+#include <stdint.h>
+
+// Tunnel tables cover one quadrant (the rest is mirrored), in cells of 4 pixels x 2 lines
+#define PAFX_TUNNEL_QW      40
+#define PAFX_TUNNEL_QH      42
+
+#define PAFX_STAR_NEAR      8           // Closest a star gets (z)
+#define PAFX_STAR_SPREAD    160         // Pixels from the centre a star at x = 128, z = PAFX_STAR_NEAR * 2 lands
+
+// 128 + 127 * sin, one cycle over 256 entries
+extern const uint8_t pafx_sin[256];
+
+// Angle round the centre (0-63 in the quadrant, of 256 for a circle)
+extern const uint8_t pafx_tunnel_angle[PAFX_TUNNEL_QH * PAFX_TUNNEL_QW];
+
+// Depth into the tunnel (inverse distance from the centre, 255 in the middle)
+extern const uint8_t pafx_tunnel_depth[PAFX_TUNNEL_QH * PAFX_TUNNEL_QW];
+
+// Perspective scale for depth z (8.8 fixed point)
+extern const uint16_t pafx_star_scale[256];
+
+#endif
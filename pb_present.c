@@ -0,0 +1,113 @@
+/*
+ * vim: set et ts=4 sw=4
+ *------------------------------------------------------------
+ *                                  ___ ___ _
+ *  ___ ___ ___ ___ ___       _____|  _| . | |_
+ * |  _| . |_ -|  _| . |     |     | . | . | '_|
+ * |_| |___|___|___|___|_____|_|_|_|___|___|_,_|
+ *                     |_____|
+ * ------------------------------------------------------------
+ * Copyright (c) 2021 Ross Bamford
+ * MIT License
+ *
+ * N-buffered playfield B presentation
+ * ------------------------------------------------------------
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "pb_present.h"
+#include "dprint.h"
+
+extern volatile uint32_t vblank_count;
+
+volatile uint16_t pb_buf_addr[PB_MAX_BUFS];
+volatile uint8_t pb_displayed = 0;
+volatile uint8_t pb_ready = PB_NONE;
+volatile uint32_t pb_ready_at = 0;
+volatile uint32_t pb_flip_vblank = 0;
+
+static uint8_t num_bufs = 0;
+static uint8_t drawing = PB_NONE;
+static uint32_t submit_vblank = 0;
+static bool measure_latency = false;
+static PbStats stats;
+
+void pb_present_init(const uint16_t *addrs, uint8_t count) {
+    num_bufs = count > PB_MAX_BUFS ? PB_MAX_BUFS : count;
+
+    for (uint8_t i = 0; i < num_bufs; i++) {
+        pb_buf_addr[i] = addrs[i];
+    }
+
+    pb_ready = PB_NONE;
+    pb_displayed = 0;
+    drawing = PB_NONE;
+}
+
+bool pb_try_acquire(uint16_t *addr) {
+    if (drawing == PB_NONE) {
+        // Ready first: the handler sets pb_displayed before clearing pb_ready, so
+        // a flip in between can only make both the same, never lose the new one
+        uint8_t ready = pb_ready;
+        uint8_t displayed = pb_displayed;
+
+        for (uint8_t i = 0; i < num_bufs; i++) {
+            if (i != displayed && i != ready) {
+                drawing = i;
+                break;
+            }
+        }
+    }
+
+    if (drawing == PB_NONE) {
+        return false;
+    }
+
+    *addr = pb_buf_addr[drawing];
+    return true;
+}
+
+bool pb_try_submit(uint32_t at_vblank) {
+    if (drawing == PB_NONE || pb_pending()) {
+        return false;
+    }
+
+    // Previous submit has been displayed by now
+    if (measure_latency) {
+        uint16_t latency = pb_flip_vblank - submit_vblank;
+
+        stats.latency_total += latency;
+        if (latency > stats.latency_max) {
+            stats.latency_max = latency;
+        }
+    }
+
+    submit_vblank = vblank_count;
+    measure_latency = true;
+
+    // Handler checks pb_ready first, so the time must be in place before it
+    pb_ready_at = at_vblank;
+    pb_ready = drawing;
+    drawing = PB_NONE;
+
+    stats.presents++;
+    return true;
+}
+
+void pb_note_stall() {
+    stats.stalls++;
+}
+
+const PbStats *pb_stats() {
+    return &stats;
+}
+
+void pb_report() {
+    uint32_t measured = stats.presents > 1 ? stats.presents - 1 : 1;
+    uint32_t avg_x10 = stats.latency_total * 10 / measured;
+
+    dprintf("PB: %d buffers, %lu presents, %lu stalls, latency avg %lu.%lu max %d vblanks\n",
+            num_bufs, stats.presents, stats.stalls, avg_x10 / 10, avg_x10 % 10, stats.latency_max);
+}
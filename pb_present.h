@@ -0,0 +1,66 @@
+/*
+ * vim: set et ts=4 sw=4
+ *------------------------------------------------------------
+ *                                  ___ ___ _
+ *  ___ ___ ___ ___ ___       _____|  _| . | |_
+ * |  _| . |_ -|  _| . |     |     | . | . | '_|
+ * |_| |___|___|___|___|_____|_|_|_|___|___|_,_|
+ *                     |_____|
+ * ------------------------------------------------------------
+ * Copyright (c) 2021 Ross Bamford
+ * MIT License
+ *
+ * N-buffered playfield B presentation
+ *
+ * Each PB buffer is either displayed, ready (completed and
+ * waiting for its vblank), or free. The main loop draws into a
+ * free buffer and submits it with the vblank it should appear
+ * on; the vblank handler flips to it once that vblank arrives.
+ * With three or more buffers there's always a free one, so the
+ * next frame can be drawn while the last is still waiting.
+ * ------------------------------------------------------------
+ */
+
+#if !defined(PB_PRESENT_H)
+#define PB_PRESENT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define PB_MAX_BUFS     4
+#define PB_NONE         0xFF
+
+// Shared with the vblank handler
+extern volatile uint16_t pb_buf_addr[PB_MAX_BUFS];
+extern volatile uint8_t pb_displayed;       // Written by handler
+extern volatile uint8_t pb_ready;           // Set by main loop, cleared (PB_NONE) by handler
+extern volatile uint32_t pb_ready_at;       // vblank_count the ready buffer should appear at
+extern volatile uint32_t pb_flip_vblank;    // vblank_count at last flip
+
+typedef struct {
+    uint32_t    presents;
+    uint32_t    stalls;                     // Times the CPU had to wait for a free buffer
+    uint32_t    latency_total;              // Vblanks from submit to display, summed
+    uint16_t    latency_max;
+} PbStats;
+
+void pb_present_init(const uint16_t *addrs, uint8_t count);
+
+// True if a frame is submitted and waiting for its vblank
+static inline bool pb_pending() {
+    return pb_ready != PB_NONE;
+}
+
+// Get a buffer to draw into, if one is free. Doesn't wait.
+bool pb_try_acquire(uint16_t *addr);
+
+// Submit the acquired buffer to be shown at vblank_count == at_vblank. Fails if one is pending.
+bool pb_try_submit(uint32_t at_vblank);
+
+// Note that no buffer was free, so the CPU had to wait (for reporting)
+void pb_note_stall();
+
+const PbStats *pb_stats();
+void pb_report();
+
+#endif
@@ -18,6 +18,7 @@
 #include <stdbool.h>
 
 #include "xosera_m68k_api.h"
+#include "pcx.h"
 #include "dprint.h"
 
 bool pcx_load_palette(uint8_t *palette_buf, uint8_t pb_transparent_idx, uint16_t pa_base, uint16_t pb_base) {
@@ -63,68 +64,51 @@ bool pcx_load_palette(uint8_t *palette_buf, uint8_t pb_transparent_idx, uint16_t
     }
 }
 
-static inline void draw(uint8_t pix) {
-    static bool high = false;
-    static uint16_t save_pix = 0;
-
-    if (high) {
-        // send to Xosera
-        xm_setw(DATA, save_pix << 8 | pix);
-        high = false;
-    } else {
-        save_pix = pix;
-        high = true;
-    }
-}
+// One row of decoded pixels, copied out with xv_copy_rect
+static uint8_t row[PCX_MAX_WIDTH];
 
 /**
- * NOTE: Image width and height must be even, and buffer is not bounds-checked!
- * Only supports 320x240 mode, Image must be even number of pixels in both
- * dimensions or weirdness will result.
+ * NOTE: buffer is not bounds-checked! Only supports 320x240 mode, and
+ * images up to PCX_MAX_WIDTH wide. Any x position or width works - rows
+ * are decoded, then copied with xv_copy_rect, which handles the edges.
  * 
  * Returns pointer to next pixel *after* end of the drawn image.
- * 
- * line_length is given in words!
  */
 uint8_t* pcx_draw_image(uint16_t xpos, uint16_t ypos, uint16_t width, uint16_t height, uint16_t vram_base, uint8_t *buf) {
-    uint16_t ystart = vram_base + (ypos * 160);
-    uint16_t xpwords = xpos >> 1;
-
 #ifdef TRACE_DEBUG
     uint8_t *start_buf = buf;
-    dprintf("   YSTART: %d\n", ystart);
 #endif
 
+    if (width > PCX_MAX_WIDTH) {
+        dprintf("ERROR: PCX image too wide (%d)\n", width);
+        return buf;
+    }
+
     for (uint16_t y = 0; y < height; y++) {
-        uint16_t linestart = ystart + (y * 160) + xpwords;
-#ifdef TRACE_DEBUG
-        dprintf("   LSTART: %d (Line %d)\n", linestart, y);
-#endif
-        xm_setw(WR_ADDR, linestart);
+        uint16_t x = 0;
 
-        for (int x = 0; x < width; x++) {
+        while (x < width) {
             uint8_t pix = *buf++;
+            uint8_t len = 1;
 
             if ((pix & 0xc0) == 0xc0) {
                 // Do a run
-                uint8_t len = pix & 0x3f;
+                len = pix & 0x3f;
                 pix = *buf++;
 
 #ifdef TRACE_DEBUG
                 dprintf("(X,Y) = (%d,%d) : Start run value %d (length %d)\n",
                     x, y, pix, len);
 #endif
+            }
 
-                for (uint8_t j = 0; j < len; j++) {
-                    draw(pix);
-                }
-
-                x += (len - 1);
-            } else {
-                // Single pixel
-                draw(pix);
+            // Runs don't carry over to the next row
+            while (len-- && x < width) {
+                row[x++] = pix;
             }
         }
+
+        xv_copy_rect(row, width, vram_base, 160, xpos, ypos + y, width, 1, 8);
     }
 
 #ifdef TRACE_DEBUG
@@ -19,6 +19,9 @@
 #include <stdbool.h>
 #include <stdint.h>
 
+// Widest image pcx_draw_image can draw
+#define PCX_MAX_WIDTH       320
+
 // Encoding constants
 #define PCX_ENC_NONE        0
 #define PCX_ENC_RLE         1
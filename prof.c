@@ -0,0 +1,211 @@
+/*
+ * vim: set et ts=4 sw=4
+ *------------------------------------------------------------
+ *                                  ___ ___ _
+ *  ___ ___ ___ ___ ___       _____|  _| . | |_
+ * |  _| . |_ -|  _| . |     |     | . | . | '_|
+ * |_| |___|___|___|___|_____|_|_|_|___|___|_,_|
+ *                     |_____|
+ * ------------------------------------------------------------
+ * Copyright (c) 2021 Ross Bamford
+ * MIT License
+ *
+ * Low-overhead timing histograms from XM_TIMER
+ * ------------------------------------------------------------
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "xosera_m68k_api.h"
+#include "prof.h"
+#include "dprint.h"
+
+ProfScope prof_scopes[PROF_MAX_SCOPES];
+bool prof_bars_on = false;
+
+extern volatile uint32_t vblank_count;
+
+static uint8_t num_scopes = 0;
+static uint32_t frames = 0;
+static uint32_t elapsed = 0;            // 1/10ms since reset, summed per frame
+static uint16_t last_frame = 0;
+
+// Raster bars state
+static uint16_t vid_ctrl_low;           // VID_CTRL bits other than the border colour
+static uint8_t cur_border = 0;
+static uint8_t orig_border = 0;
+static uint16_t vis_lines;
+static uint16_t total_lines;
+
+int8_t prof_scope(const char *name, uint16_t bucket_ticks, uint8_t border) {
+    if (num_scopes == PROF_MAX_SCOPES) {
+        return -1;
+    }
+
+    ProfScope *scope = &prof_scopes[num_scopes];
+
+    memset(scope, 0, sizeof(ProfScope));
+    scope->name = name;
+    scope->bucket_ticks = bucket_ticks ? bucket_ticks : 1;
+    scope->border = border;
+    scope->min = 0xFFFF;
+
+    return num_scopes++;
+}
+
+static inline void set_border(uint8_t color) {
+    xreg_setw(VID_CTRL, MAKE_VID_CTRL(color, 0) | vid_ctrl_low);
+    cur_border = color;
+}
+
+/*
+ * Beam position as (frame, line), with lines counted from the start
+ * of vblank so they line up with vblank_count. Re-reads if a vblank
+ * sneaks in between the two.
+ */
+static uint16_t beam_line(uint32_t *frame) {
+    uint32_t before;
+    uint16_t line;
+
+    do {
+        before = vblank_count;
+        line = xreg_getw(SCANLINE) & 0x7FF;
+        *frame = vblank_count;
+    } while (*frame != before);
+
+    return line >= vis_lines ? line - vis_lines : line + total_lines - vis_lines;
+}
+
+void prof_bars(bool enable, uint16_t frame_lines) {
+    if (enable && !prof_bars_on) {
+        uint16_t vid_ctrl = xreg_getw(VID_CTRL);
+
+        vid_ctrl_low = vid_ctrl & 0x00FF;
+        cur_border = orig_border = vid_ctrl >> 8;
+        vis_lines = xreg_getw(VID_VSIZE);
+        total_lines = frame_lines;
+    } else if (!enable && prof_bars_on) {
+        set_border(orig_border);
+    }
+
+    prof_bars_on = enable;
+}
+
+void prof_bar_begin(ProfScope *scope) {
+    scope->saved_border = cur_border;
+    set_border(scope->border);
+    scope->start_line = beam_line(&scope->start_frame);
+}
+
+static void bar_end(ProfScope *scope) {
+    uint32_t frame;
+    uint16_t line = beam_line(&frame);
+    uint32_t lines = (frame - scope->start_frame) * total_lines + line - scope->start_line;
+
+    set_border(scope->saved_border);
+
+    scope->total_lines += lines;
+    if (lines > scope->max_lines) {
+        scope->max_lines = lines > 0xFFFF ? 0xFFFF : lines;
+    }
+}
+
+void prof_end(int8_t id) {
+    ProfScope *scope = &prof_scopes[id];
+    uint16_t ticks = xm_getw(TIMER) - scope->start;
+
+    if (prof_bars_on) {
+        bar_end(scope);
+    }
+    uint16_t bucket = ticks / scope->bucket_ticks;
+
+    scope->hist[bucket < PROF_BUCKETS ? bucket : PROF_BUCKETS - 1]++;
+    scope->count++;
+    scope->total += ticks;
+
+    if (ticks < scope->min) {
+        scope->min = ticks;
+    }
+    if (ticks > scope->max) {
+        scope->max = ticks;
+    }
+}
+
+void prof_frame() {
+    uint16_t now = xm_getw(TIMER);
+
+    // Summed a frame at a time, since the timer itself wraps every 6.5s
+    if (frames++) {
+        elapsed += (uint16_t)(now - last_frame);
+    }
+
+    last_frame = now;
+}
+
+void prof_reset() {
+    for (int i = 0; i < num_scopes; i++) {
+        ProfScope *scope = &prof_scopes[i];
+
+        memset(scope->hist, 0, sizeof(scope->hist));
+        scope->count = 0;
+        scope->total = 0;
+        scope->min = 0xFFFF;
+        scope->max = 0;
+        scope->total_lines = 0;
+        scope->max_lines = 0;
+    }
+
+    frames = 0;
+    elapsed = 0;
+}
+
+/* Upper edge of the bucket holding the 95th percentile (capped at max) */
+static uint16_t p95(const ProfScope *scope) {
+    uint32_t want = (scope->count * 95 + 99) / 100;
+    uint32_t seen = 0;
+
+    for (int b = 0; b < PROF_BUCKETS - 1; b++) {
+        seen += scope->hist[b];
+
+        if (seen >= want) {
+            uint16_t edge = (b + 1) * scope->bucket_ticks;
+            return edge < scope->max ? edge : scope->max;
+        }
+    }
+
+    return scope->max;
+}
+
+static void print_ms(const char *label, uint32_t ticks) {
+    dprintf(" %s %3lu.%lu", label, ticks / 10, ticks % 10);
+}
+
+void prof_report() {
+    dprintf("Profile over %lu frames", frames);
+    if (elapsed) {
+        uint32_t fps_x10 = (frames - 1) * 100000 / elapsed;
+        dprintf(" (%lu.%lu frames/s)", fps_x10 / 10, fps_x10 % 10);
+    }
+    dprintf(", times in ms:\n");
+
+    for (int i = 0; i < num_scopes; i++) {
+        const ProfScope *scope = &prof_scopes[i];
+
+        dprintf("  %-16s n=%-6lu", scope->name, scope->count);
+
+        if (scope->count) {
+            print_ms("min", scope->min);
+            print_ms("avg", scope->total / scope->count);
+            print_ms("p95", p95(scope));
+            print_ms("max", scope->max);
+
+            if (prof_bars_on) {
+                dprintf("  lines avg %lu max %u", scope->total_lines / scope->count, scope->max_lines);
+            }
+        }
+
+        dprintf("\n");
+    }
+}
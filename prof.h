@@ -0,0 +1,84 @@
+/*
+ * vim: set et ts=4 sw=4
+ *------------------------------------------------------------
+ *                                  ___ ___ _
+ *  ___ ___ ___ ___ ___       _____|  _| . | |_
+ * |  _| . |_ -|  _| . |     |     | . | . | '_|
+ * |_| |___|___|___|___|_____|_|_|_|___|___|_,_|
+ *                     |_____|
+ * ------------------------------------------------------------
+ * Copyright (c) 2021 Ross Bamford
+ * MIT License
+ *
+ * Low-overhead timing histograms from XM_TIMER
+ *
+ * Named scopes are timed in 1/10ms ticks and accumulated into
+ * fixed-width bucket histograms in RAM. Nothing is printed
+ * until prof_report(), so timing doesn't disturb itself.
+ *
+ * Optionally (prof_bars()), each scope also sets its own border
+ * colour while it runs, so the border shows a live stacked bar
+ * of CPU time against the beam, and the scanlines each scope
+ * took are counted from XR_SCANLINE for the report.
+ * ------------------------------------------------------------
+ */
+
+#if !defined(PROF_H)
+#define PROF_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "xosera_m68k_api.h"
+
+#define PROF_MAX_SCOPES     8
+#define PROF_BUCKETS        32          // Last bucket catches everything longer
+
+typedef struct {
+    const char  *name;
+    uint16_t    bucket_ticks;           // Width of each histogram bucket
+    uint8_t     border;                 // Border colour index while running (bars mode)
+    uint8_t     saved_border;
+    uint32_t    start_frame;            // Scanline position at entry (bars mode)
+    uint16_t    start_line;
+    uint16_t    max_lines;
+    uint32_t    total_lines;
+    uint16_t    start;
+    uint16_t    min;
+    uint16_t    max;
+    uint32_t    count;
+    uint32_t    total;
+    uint16_t    hist[PROF_BUCKETS];
+} ProfScope;
+
+extern ProfScope prof_scopes[PROF_MAX_SCOPES];
+extern bool prof_bars_on;
+
+// Register a scope. Returns its id (for prof_begin/prof_end), or -1 if full.
+int8_t prof_scope(const char *name, uint16_t bucket_ticks, uint8_t border);
+
+/*
+ * Enable or disable raster bars. frame_lines is the total scanlines
+ * per frame including blanking (e.g. 525 for 640x480).
+ */
+void prof_bars(bool enable, uint16_t frame_lines);
+
+void prof_bar_begin(ProfScope *scope);
+
+static inline void prof_begin(int8_t id) {
+    if (prof_bars_on) {
+        prof_bar_begin(&prof_scopes[id]);
+    }
+
+    prof_scopes[id].start = xm_getw(TIMER);
+}
+
+void prof_end(int8_t id);
+
+// Call once per presented frame (for frames/s)
+void prof_frame();
+
+void prof_reset();
+void prof_report();
+
+#endif
@@ -0,0 +1,145 @@
+/*
+ * vim: set et ts=4 sw=4
+ *------------------------------------------------------------
+ *                                  ___ ___ _
+ *  ___ ___ ___ ___ ___       _____|  _| . | |_
+ * |  _| . |_ -|  _| . |     |     | . | . | '_|
+ * |_| |___|___|___|___|_____|_|_|_|___|___|_,_|
+ *                     |_____|
+ * ------------------------------------------------------------
+ * Copyright (c) 2021 Ross Bamford
+ * MIT License
+ *
+ * RAM arena allocator
+ * ------------------------------------------------------------
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "ram_arena.h"
+#include "dprint.h"
+
+// Firmware system data block
+#define SDB_ADDR            0x400
+#define SDB_MAGIC           0xB105D47A
+#define SDB_MEMSIZE_OFFSET  0x18
+
+typedef struct {
+    const char  *name;
+    uint32_t    base;
+    uint32_t    next;
+    uint32_t    limit;
+} RamPool;
+
+extern void* _end;
+
+static RamPool pools[RAM_NUM_POOLS] = {
+    { "frames",  0, 0, 0 },
+    { "loading", 0, 0, 0 },
+    { "scratch", 0, 0, 0 },
+};
+
+static uint32_t installed;
+
+static uint32_t detect_ram() {
+    volatile uint8_t *sdb = (volatile uint8_t *)SDB_ADDR;
+
+    __asm__ ("" : "+a" (sdb));          // Hide the fixed address, or GCC thinks it's out of bounds
+
+    if (*(volatile uint32_t *)sdb != SDB_MAGIC) {
+        dprintf("RAM: No system data block, assuming on-board RAM only\n");
+        return RAM_ONBOARD_TOP;
+    }
+
+    uint32_t size = *(volatile uint32_t *)(sdb + SDB_MEMSIZE_OFFSET);
+
+    if (size < RAM_ONBOARD_TOP || size > RAM_MAX_TOP) {
+        dprintf("RAM: Firmware says %lu bytes, assuming on-board RAM only\n", size);
+        return RAM_ONBOARD_TOP;
+    }
+
+    return size;
+}
+
+static void set_pool(uint8_t pool, uint32_t base, uint32_t limit) {
+    pools[pool].base = base;
+    pools[pool].next = base;
+    pools[pool].limit = limit;
+}
+
+bool ram_init(uint32_t loading_bytes, uint32_t scratch_bytes) {
+    uint32_t low = ((uint32_t)&_end + 3) & ~3;
+    uint32_t sp = (uint32_t)__builtin_frame_address(0);
+    uint32_t top = sp > low + RAM_STACK_GUARD ? (sp - RAM_STACK_GUARD) & ~3 : low;
+
+    installed = detect_ram();
+
+    loading_bytes = (loading_bytes + 3) & ~3;
+    scratch_bytes = (scratch_bytes + 3) & ~3;
+
+    if (top - low < loading_bytes + scratch_bytes) {
+        dprintf("RAM: Only %lu bytes below the stack, need %lu\n", top - low, loading_bytes + scratch_bytes);
+        set_pool(RAM_POOL_FRAMES, low, low);
+        set_pool(RAM_POOL_LOADING, low, low);
+        set_pool(RAM_POOL_SCRATCH, low, low);
+        return false;
+    }
+
+    // Loading and scratch just under the stack guard...
+    set_pool(RAM_POOL_SCRATCH, top - scratch_bytes, top);
+    top -= scratch_bytes;
+    set_pool(RAM_POOL_LOADING, top - loading_bytes, top);
+    top -= loading_bytes;
+
+    // ... and frames get the rest, or expansion RAM (above the stack) if that's bigger
+    set_pool(RAM_POOL_FRAMES, low, top);
+    if (installed > RAM_ONBOARD_TOP && sp <= RAM_ONBOARD_TOP
+            && installed - RAM_ONBOARD_TOP > top - low) {
+        set_pool(RAM_POOL_FRAMES, RAM_ONBOARD_TOP, installed);
+    }
+
+    return true;
+}
+
+void *ram_alloc(uint8_t pool, uint32_t bytes) {
+    RamPool *p = &pools[pool];
+
+    bytes = (bytes + 3) & ~3;
+
+    if (p->limit - p->next < bytes) {
+        dprintf("RAM: No room in '%s' (%lu bytes, %lu free)\n", p->name, bytes, p->limit - p->next);
+        return NULL;
+    }
+
+    void *result = (void *)p->next;
+    p->next += bytes;
+
+    return result;
+}
+
+void *ram_next(uint8_t pool) {
+    return (void *)pools[pool].next;
+}
+
+void ram_release(uint8_t pool) {
+    pools[pool].next = pools[pool].base;
+}
+
+uint32_t ram_pool_free(uint8_t pool) {
+    return pools[pool].limit - pools[pool].next;
+}
+
+uint32_t ram_installed() {
+    return installed;
+}
+
+void ram_report() {
+    dprintf("RAM: %luKB installed, program ends at 0x%08lx\n", installed >> 10, (uint32_t)&_end);
+
+    for (int i = 0; i < RAM_NUM_POOLS; i++) {
+        dprintf("RAM: 0x%08lx-0x%08lx %-12s %lu of %lu bytes used\n", pools[i].base, pools[i].limit,
+                pools[i].name, pools[i].next - pools[i].base, pools[i].limit - pools[i].base);
+    }
+}
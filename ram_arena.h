@@ -0,0 +1,69 @@
+/*
+ * vim: set et ts=4 sw=4
+ *------------------------------------------------------------
+ *                                  ___ ___ _
+ *  ___ ___ ___ ___ ___       _____|  _| . | |_
+ * |  _| . |_ -|  _| . |     |     | . | . | '_|
+ * |_| |___|___|___|___|_____|_|_|_|___|___|_,_|
+ *                     |_____|
+ * ------------------------------------------------------------
+ * Copyright (c) 2021 Ross Bamford
+ * MIT License
+ *
+ * RAM arena allocator
+ *
+ * Manages the free RAM between the end of the program (_end)
+ * and the stack, plus expansion RAM above the on-board 1MB
+ * if the firmware reports any. Installed RAM comes from the
+ * firmware's system data block, and the top of the low block
+ * stops RAM_STACK_GUARD bytes short of the stack pointer at
+ * ram_init(), so nothing handed out can run into the stack.
+ *
+ * Space is split into pools by lifetime. The loading and
+ * scratch pools are fixed-size and carved off first; frames
+ * get whatever is left (all of expansion RAM, if there is
+ * more of that than on-board). Allocation within a pool is a
+ * simple bump, and a pool can be released as a whole.
+ * ------------------------------------------------------------
+ */
+
+#if !defined(RAM_ARENA_H)
+#define RAM_ARENA_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define RAM_ONBOARD_TOP     0x100000    // On-board RAM is 1MB, expansion starts here
+#define RAM_MAX_TOP         0xE00000    // Expansion is at most 14MB (I/O lives above)
+#define RAM_STACK_GUARD     0x4000      // Bytes kept clear below the stack pointer
+
+// Lifetime pools
+#define RAM_POOL_FRAMES     0           // Loaded frames, live until exit
+#define RAM_POOL_LOADING    1           // Loading screen and other files read while loading
+#define RAM_POOL_SCRATCH    2           // Short-lived work space
+#define RAM_NUM_POOLS       3
+
+/*
+ * Find installed RAM and lay out the pools. False if there isn't
+ * room for the loading and scratch pools (frames get the rest,
+ * which might be nothing).
+ */
+bool ram_init(uint32_t loading_bytes, uint32_t scratch_bytes);
+
+// Allocate bytes (rounded up to a long) from pool. Returns NULL if it won't fit.
+void *ram_alloc(uint8_t pool, uint32_t bytes);
+
+// Where the next allocation from pool will start (to fill in before committing with ram_alloc)
+void *ram_next(uint8_t pool);
+
+// Free everything allocated from pool
+void ram_release(uint8_t pool);
+
+uint32_t ram_pool_free(uint8_t pool);
+
+// RAM the firmware says is installed (or on-board RAM if it doesn't say)
+uint32_t ram_installed();
+
+void ram_report();
+
+#endif
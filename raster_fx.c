@@ -0,0 +1,144 @@
+/*
+ * vim: set et ts=4 sw=4
+ *------------------------------------------------------------
+ *                                  ___ ___ _
+ *  ___ ___ ___ ___ ___       _____|  _| . | |_
+ * |  _| . |_ -|  _| . |     |     | . | . | '_|
+ * |_| |___|___|___|___|_____|_|_|_|___|___|_,_|
+ *                     |_____|
+ * ------------------------------------------------------------
+ * Copyright (c) 2021 Ross Bamford
+ * MIT License
+ *
+ * Copper raster effects (wobble, parallax, split scroll)
+ * ------------------------------------------------------------
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "copper.h"
+#include "raster_fx.h"
+
+// 127 * sin(2 * pi * i / 256)
+const int8_t rfx_sine[256] = {
+       0,    3,    6,    9,   12,   16,   19,   22,   25,   28,   31,   34,   37,   40,   43,   46,
+      49,   51,   54,   57,   60,   63,   65,   68,   71,   73,   76,   78,   81,   83,   85,   88,
+      90,   92,   94,   96,   98,  100,  102,  104,  106,  107,  109,  111,  112,  113,  115,  116,
+     117,  118,  120,  121,  122,  122,  123,  124,  125,  125,  126,  126,  126,  127,  127,  127,
+     127,  127,  127,  127,  126,  126,  126,  125,  125,  124,  123,  122,  122,  121,  120,  118,
+     117,  116,  115,  113,  112,  111,  109,  107,  106,  104,  102,  100,   98,   96,   94,   92,
+      90,   88,   85,   83,   81,   78,   76,   73,   71,   68,   65,   63,   60,   57,   54,   51,
+      49,   46,   43,   40,   37,   34,   31,   28,   25,   22,   19,   16,   12,    9,    6,    3,
+       0,   -3,   -6,   -9,  -12,  -16,  -19,  -22,  -25,  -28,  -31,  -34,  -37,  -40,  -43,  -46,
+     -49,  -51,  -54,  -57,  -60,  -63,  -65,  -68,  -71,  -73,  -76,  -78,  -81,  -83,  -85,  -88,
+     -90,  -92,  -94,  -96,  -98, -100, -102, -104, -106, -107, -109, -111, -112, -113, -115, -116,
+    -117, -118, -120, -121, -122, -122, -123, -124, -125, -125, -126, -126, -126, -127, -127, -127,
+    -127, -127, -127, -127, -126, -126, -126, -125, -125, -124, -123, -122, -122, -121, -120, -118,
+    -117, -116, -115, -113, -112, -111, -109, -107, -106, -104, -102, -100,  -98,  -96,  -94,  -92,
+     -90,  -88,  -85,  -83,  -81,  -78,  -76,  -73,  -71,  -68,  -65,  -63,  -60,  -57,  -54,  -51,
+     -49,  -46,  -43,  -40,  -37,  -34,  -31,  -28,  -25,  -22,  -19,  -16,  -12,   -9,   -6,   -3,
+};
+
+static const uint8_t target_regs[3] = { XR_PA_HV_SCROLL, XR_PA_LINE_ADDR, XR_PB_HV_SCROLL };
+
+static int16_t wave_sum(const RfxDesc *desc, uint8_t target, uint16_t band, uint16_t frame) {
+    int16_t sum = 0;
+
+    for (int w = 0; w < desc->num_waves; w++) {
+        const RfxWave *wave = &desc->waves[w];
+
+        if (wave->target == target) {
+            uint8_t idx = (band * wave->frequency + frame * wave->speed) & 0xFF;
+            sum += wave->offset + (rfx_sine[idx] * wave->amplitude) / 127;
+        }
+    }
+
+    return sum;
+}
+
+static uint16_t band_value(const RfxDesc *desc, uint8_t target, uint16_t band, uint16_t frame) {
+    int16_t v = wave_sum(desc, target, band, frame);
+
+    if (target == RFX_PA_LINE) {
+        int16_t line = (band * desc->band_height) / desc->line_div + v;
+        return desc->line_base + line * desc->line_len;
+    } else {
+        if (v < 0) {
+            v = 0;
+        } else if (v > RFX_MAX_HSCROLL) {
+            v = RFX_MAX_HSCROLL;
+        }
+        return MAKE_HV_SCROLL(v, 0);
+    }
+}
+
+bool rfx_build(RfxState *fx, const RfxDesc *desc, CopProg *prog) {
+    fx->desc = desc;
+    fx->frame = 0;
+    fx->targets = 0;
+    fx->per_band = 1;
+
+    if (!desc->band_height || !desc->line_div || desc->bottom <= desc->top) {
+        return false;
+    }
+
+    for (int w = 0; w < desc->num_waves; w++) {
+        fx->targets |= desc->waves[w].target;
+    }
+
+    for (int t = 0; t < 3; t++) {
+        if (fx->targets & (1 << t)) {
+            fx->per_band++;
+        }
+    }
+
+    fx->bands = (desc->bottom - desc->top + desc->band_height - 1) / desc->band_height;
+    fx->first = prog->len;
+
+    for (uint16_t b = 0; b < fx->bands; b++) {
+        cop_wait_v(prog, desc->top + b * desc->band_height);
+
+        for (int t = 0; t < 3; t++) {
+            if (fx->targets & (1 << t)) {
+                cop_mover(prog, target_regs[t], band_value(desc, 1 << t, b, 0));
+            }
+        }
+    }
+
+    // Put the scroll registers back for the rest of the frame
+    cop_wait_v(prog, desc->bottom);
+    if (fx->targets & RFX_PA_HSCROLL) {
+        cop_mover(prog, XR_PA_HV_SCROLL, 0);
+    }
+    if (fx->targets & RFX_PB_HSCROLL) {
+        cop_mover(prog, XR_PB_HV_SCROLL, 0);
+    }
+
+    return !prog->overflow;
+}
+
+uint16_t rfx_animate(RfxState *fx, CopProg *prog) {
+    uint16_t patched = 0;
+
+    fx->frame++;
+
+    for (uint16_t b = 0; b < fx->bands; b++) {
+        uint16_t idx = fx->first + b * fx->per_band + 1;
+
+        for (int t = 0; t < 3; t++) {
+            if (fx->targets & (1 << t)) {
+                uint16_t val = band_value(fx->desc, 1 << t, b, fx->frame);
+
+                if ((prog->code[idx] & 0xFFFF) != val) {
+                    cop_patch_value(prog, idx, val);
+                    patched++;
+                }
+
+                idx++;
+            }
+        }
+    }
+
+    return patched;
+}
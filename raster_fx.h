@@ -0,0 +1,79 @@
+/*
+ * vim: set et ts=4 sw=4
+ *------------------------------------------------------------
+ *                                  ___ ___ _
+ *  ___ ___ ___ ___ ___       _____|  _| . | |_
+ * |  _| . |_ -|  _| . |     |     | . | . | '_|
+ * |_| |___|___|___|___|_____|_|_|_|___|___|_,_|
+ *                     |_____|
+ * ------------------------------------------------------------
+ * Copyright (c) 2021 Ross Bamford
+ * MIT License
+ *
+ * Copper raster effects (wobble, parallax, split scroll)
+ *
+ * Describes per-band register writes as a set of sine waves,
+ * and generates the copper instructions for them into a
+ * CopProg. Each band is a WAIT followed by one MOVER per
+ * driven register, so animating is just patching the MOVER
+ * values - cop_raster_present() then uploads only those.
+ *
+ * Only builds instructions in RAM and never touches Xosera
+ * (copper.h is just for CopProg and the instruction macros),
+ * so it also builds on the host - utils/raster_fx_test.c
+ * checks the programs it generates.
+ * ------------------------------------------------------------
+ */
+
+#if !defined(RASTER_FX_H)
+#define RASTER_FX_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "copper.h"
+
+// Registers a wave can drive (also the order they're written in each band)
+#define RFX_PA_HSCROLL      0x01        // PA_HV_SCROLL horizontal fine scroll
+#define RFX_PA_LINE         0x02        // PA_LINE_ADDR line offset (in playfield lines)
+#define RFX_PB_HSCROLL      0x04        // PB_HV_SCROLL horizontal fine scroll
+
+#define RFX_MAX_HSCROLL     31
+
+typedef struct {
+    uint8_t         target;         // One of RFX_*
+    int8_t          amplitude;      // Peak deviation from offset
+    uint8_t         frequency;      // Sine table steps (of 256) between bands
+    uint8_t         speed;          // Sine table steps per frame
+    int16_t         offset;         // Constant added to the wave
+} RfxWave;
+
+typedef struct {
+    uint16_t        top;            // First native scanline affected
+    uint16_t        bottom;         // Native scanline where effect ends (registers reset)
+    uint8_t         band_height;    // Native scanlines per band (1 == every scanline)
+    uint8_t         line_div;       // Native scanlines per playfield line (2 for Vx2)
+    uint16_t        line_base;      // RFX_PA_LINE: VRAM address of the line shown at top
+    uint16_t        line_len;       // RFX_PA_LINE: words per playfield line
+    uint8_t         num_waves;
+    const RfxWave   *waves;
+} RfxDesc;
+
+typedef struct {
+    const RfxDesc   *desc;
+    uint16_t        first;          // Index of first band's WAIT in the program
+    uint16_t        bands;
+    uint8_t         targets;        // RFX_* driven by at least one wave
+    uint8_t         per_band;       // Instructions per band
+    uint16_t        frame;
+} RfxState;
+
+extern const int8_t rfx_sine[256];
+
+// Append bands for desc to prog (at the current end), ready for frame 0
+bool rfx_build(RfxState *fx, const RfxDesc *desc, CopProg *prog);
+
+// Advance one frame and patch the changed values in prog. Returns values patched.
+uint16_t rfx_animate(RfxState *fx, CopProg *prog);
+
+#endif
@@ -0,0 +1,67 @@
+/*
+ * vim: set et ts=4 sw=4
+ *------------------------------------------------------------
+ *                                  ___ ___ _
+ *  ___ ___ ___ ___ ___       _____|  _| . | |_
+ * |  _| . |_ -|  _| . |     |     | . | . | '_|
+ * |_| |___|___|___|___|_____|_|_|_|___|___|_,_|
+ *                     |_____|
+ * ------------------------------------------------------------
+ * Copyright (c) 2021 Ross Bamford
+ * MIT License
+ *
+ * Hardware-scrolled ring buffer canvas
+ * ------------------------------------------------------------
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "xosera_m68k_api.h"
+#include "copper.h"
+#include "scroll_canvas.h"
+
+void sc_init(ScrollCanvas *sc, uint16_t vram_base, uint16_t line_len, uint16_t rows,
+             uint16_t scanline, uint8_t line_div, uint8_t xreg_line) {
+    sc->vram_base = vram_base;
+    sc->line_len = line_len;
+    sc->rows = rows;
+    sc->scanline = scanline;
+    sc->line_div = line_div;
+    sc->xreg_line = xreg_line;
+    sc->top = 0;
+}
+
+/*
+ * Visible row (rows + 1 - top) is where the ring wraps. When top is
+ * zero that's past the bottom, so the wrap is parked on the line after
+ * the last visible row (harmless there) and the program always has the
+ * same shape.
+ */
+static uint16_t wrap_scanline(const ScrollCanvas *sc) {
+    uint16_t wrap_row = sc->rows + 1 - sc->top;
+
+    if (wrap_row > sc->rows) {
+        wrap_row = sc->rows;
+    }
+
+    return sc->scanline + wrap_row * sc->line_div;
+}
+
+void sc_build(ScrollCanvas *sc, CopProg *prog) {
+    sc->cop_start = cop_mover(prog, sc->xreg_line, sc_row_addr(sc, 0));
+    sc->cop_wrap = cop_wait_v(prog, wrap_scanline(sc));
+    cop_mover(prog, sc->xreg_line, sc->vram_base);
+}
+
+void sc_advance(ScrollCanvas *sc, CopProg *prog, uint16_t clear_word) {
+    if (++sc->top > sc->rows) {
+        sc->top = 0;
+    }
+
+    // New bottom row was the spare, so isn't on screen yet
+    xv_vram_fill(sc_row_addr(sc, sc->rows - 1), sc->line_len, clear_word);
+
+    cop_patch_value(prog, sc->cop_start, sc_row_addr(sc, 0));
+    prog->code[sc->cop_wrap] = COP_WAIT_V(wrap_scanline(sc));
+}
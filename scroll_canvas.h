@@ -0,0 +1,67 @@
+/*
+ * vim: set et ts=4 sw=4
+ *------------------------------------------------------------
+ *                                  ___ ___ _
+ *  ___ ___ ___ ___ ___       _____|  _| . | |_
+ * |  _| . |_ -|  _| . |     |     | . | . | '_|
+ * |_| |___|___|___|___|_____|_|_|_|___|___|_,_|
+ *                     |_____|
+ * ------------------------------------------------------------
+ * Copyright (c) 2021 Ross Bamford
+ * MIT License
+ *
+ * Hardware-scrolled ring buffer canvas
+ *
+ * The canvas is a vertical ring of rows in VRAM, one more than
+ * are visible. Scrolling just moves the top row; the copper sets
+ * LINE_ADDR to it where the playfield starts, and again to the
+ * start of the ring at the line where it wraps. Only the newly
+ * exposed row is cleared, and since that's the spare row it's
+ * never on screen while it's being cleared.
+ * ------------------------------------------------------------
+ */
+
+#if !defined(SCROLL_CANVAS_H)
+#define SCROLL_CANVAS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "copper.h"
+
+typedef struct {
+    uint16_t    vram_base;      // VRAM address of ring row 0
+    uint16_t    line_len;       // Words per row
+    uint16_t    rows;           // Visible rows (ring holds one more)
+    uint16_t    scanline;       // Native scanline where the playfield starts
+    uint8_t     line_div;       // Native scanlines per row (2 for Vx2)
+    uint8_t     xreg_line;      // XR_PA_LINE_ADDR or XR_PB_LINE_ADDR
+    uint16_t    top;            // Ring row currently at the top of the display
+    uint16_t    cop_start;      // Copper instruction index setting LINE_ADDR at start
+    uint16_t    cop_wrap;       // Copper instruction index of the wrap WAIT
+} ScrollCanvas;
+
+// VRAM words needed for a canvas with this many visible rows
+#define SC_VRAM_WORDS(rows, line_len)   (((rows) + 1) * (line_len))
+
+void sc_init(ScrollCanvas *sc, uint16_t vram_base, uint16_t line_len, uint16_t rows,
+             uint16_t scanline, uint8_t line_div, uint8_t xreg_line);
+
+// Ring row displayed at visible row y
+static inline uint16_t sc_row(const ScrollCanvas *sc, uint16_t y) {
+    uint16_t row = sc->top + y;
+    return row > sc->rows ? row - (sc->rows + 1) : row;
+}
+
+// VRAM address of visible row y
+static inline uint16_t sc_row_addr(const ScrollCanvas *sc, uint16_t y) {
+    return sc->vram_base + sc_row(sc, y) * sc->line_len;
+}
+
+// Append the start and wrap LINE_ADDR writes (call right after the WAIT for sc->scanline)
+void sc_build(ScrollCanvas *sc, CopProg *prog);
+
+// Scroll up by one row, clearing the row that comes into view, and patch prog to match
+void sc_advance(ScrollCanvas *sc, CopProg *prog, uint16_t clear_word);
+
+#endif
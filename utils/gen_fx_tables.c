@@ -0,0 +1,78 @@
+/*
+ * vim: set et ts=4 sw=4
+ *------------------------------------------------------------
+ *                                  ___ ___ _
+ *  ___ ___ ___ ___ ___       _____|  _| . | |_
+ * |  _| . |_ -|  _| . |     |     | . | . | '_|
+ * |_| |___|___|___|___|_____|_|_|_|___|___|_,_|
+ *                     |_____|
+ * ------------------------------------------------------------
+ * Copyright (c) 2021 Ross Bamford
+ * MIT License
+ *
+ * Generates pa_fx_tables.c (runs on the build host)
+ *
+ *   gen_fx_tables > pa_fx_tables.c
+ * ------------------------------------------------------------
+ */
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "../pa_fx_tables.h"
+
+#define PI              3.14159265358979323846
+#define TUNNEL_RADIUS   2048.0          // Depth is this over the distance in pixels
+
+static void table_start(const char *type, const char *name, const char *size) {
+    printf("\nconst %s %s[%s] = {", type, name, size);
+}
+
+static void table_entry(int i, int value, int per_line) {
+    printf("%s%s%d", i ? "," : "", i % per_line ? " " : "\n    ", value);
+}
+
+static void table_end() {
+    printf("\n};\n");
+}
+
+int main() {
+    printf("/* Generated by utils/gen_fx_tables.c - do not edit */\n\n");
+    printf("#include <stdint.h>\n\n#include \"pa_fx_tables.h\"\n");
+
+    table_start("uint8_t", "pafx_sin", "256");
+    for (int i = 0; i < 256; i++) {
+        table_entry(i, (int)lround(128.0 + 127.0 * sin(i * 2.0 * PI / 256.0)), 16);
+    }
+    table_end();
+
+    // Cell centres, measured from the middle of the canvas
+    table_start("uint8_t", "pafx_tunnel_angle", "PAFX_TUNNEL_QH * PAFX_TUNNEL_QW");
+    for (int y = 0; y < PAFX_TUNNEL_QH; y++) {
+        for (int x = 0; x < PAFX_TUNNEL_QW; x++) {
+            double a = atan2(y * 2 + 1, x * 4 + 2) * 256.0 / (2.0 * PI);
+            table_entry(y * PAFX_TUNNEL_QW + x, (int)a & 63, 20);
+        }
+    }
+    table_end();
+
+    table_start("uint8_t", "pafx_tunnel_depth", "PAFX_TUNNEL_QH * PAFX_TUNNEL_QW");
+    for (int y = 0; y < PAFX_TUNNEL_QH; y++) {
+        for (int x = 0; x < PAFX_TUNNEL_QW; x++) {
+            double r = hypot(y * 2 + 1, x * 4 + 2);
+            double d = TUNNEL_RADIUS / r;
+            table_entry(y * PAFX_TUNNEL_QW + x, d > 255.0 ? 255 : (int)d, 20);
+        }
+    }
+    table_end();
+
+    table_start("uint16_t", "pafx_star_scale", "256");
+    for (int z = 0; z < 256; z++) {
+        int scale = z < PAFX_STAR_NEAR ? 0 : (PAFX_STAR_SPREAD * 2 * PAFX_STAR_NEAR * 256) / (128 * z);
+        table_entry(z, scale, 16);
+    }
+    table_end();
+
+    return 0;
+}
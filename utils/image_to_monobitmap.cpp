@@ -6,16 +6,91 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
 bool   word_mode = false;
 bool   c_mode    = false;
 bool   invert    = false;
+bool   tile_mode = false;
+bool   quiet     = false;
+bool   color     = false;
+int    bpp       = 0;        // 4 or 8 for indexed colour output
+bool   dither    = false;
+bool   frame_pal = false;    // Indexed: palette per frame, rather than shared
+bool   bench     = false;
+char * loading   = nullptr;  // C mode: loading image file to embed as-is
+bool   anim_mode = false;    // Animated GIF / APNG input
+int    anim_rate = 0;        // Animated: output frames per second (0 == one per source frame)
+bool   bench_suite = false;  // Stage benchmark over the input files, to CSV
+char * synth_geom  = nullptr; // Write a synthetic test image of this size (WxH)
 char * in_file   = nullptr;
 char * out_file  = nullptr;
 
 int out_width  = 320;
 int out_height = 240;
+int phys_width = 640;        // Display width out_width is shown at (480 lines high), for pixel aspect
+
+// Scaling to out_width x out_height: crop (or zero pad) as-is, or fit with a filter
+enum Fit
+{
+    FIT_CROP,
+    FIT_AREA,
+    FIT_LANCZOS
+};
+Fit fit_mode = FIT_CROP;
+
+// Output geometries for -geom (half-height ones are shown with pixels twice as tall)
+struct Geometry
+{
+    int w, h, phys_w;
+};
+const Geometry geometries[] = {
+    {320, 240, 640}, {640, 480, 640}, {640, 240, 640}, {848, 480, 848}, {848, 240, 848}, {424, 240, 848}};
+
+// Tile mode: 1bpp tilemap entries index 256 glyphs (4 words each in tile memory)
+const int MAX_GLYPHS = 256;
+
+// Color mode: the 16 colours attribute nybbles can pick from (RGB444, CGA-like)
+const uint16_t color_palette[16] = {0x000,
+                                    0x00A,
+                                    0x0A0,
+                                    0x0AA,
+                                    0xA00,
+                                    0xA0A,
+                                    0xA50,
+                                    0xAAA,
+                                    0x555,
+                                    0x55F,
+                                    0x5F5,
+                                    0x5FF,
+                                    0xF55,
+                                    0xF5F,
+                                    0xFF5,
+                                    0xFFF};
+
+// Frames for the multi-image modes (-t, -bpp, -c)
+std::vector<char *> frame_files;
 
 Uint32 getpixel(SDL_Surface * surface, int x, int y);
+SDL_Surface * load_image(const char * file);
+SDL_Surface * fit_surface(SDL_Surface * image);
+void   image_to_mono(SDL_Surface * image, uint8_t * out_pixels);
+void   image_to_color(SDL_Surface * image, uint8_t * out_words);
+bool   write_palette(const char * out_file);
+int    write_tiles(const char * out_dir);
+int    write_indexed(const char * out_dir);
+int    write_c_arrays(const char * out_c);
+int    write_anim(const char * out_dir, const char * anim_file);
+int    run_bench_suite(const char * csv_file, int reps);
+int    write_synthetic(const char * geom, const char * out_png);
 
 int main(int argc, char ** argv)
 {
@@ -31,7 +106,108 @@ int main(int argc, char ** argv)
             }
             else if (strcmp("-848", argv[a]) == 0)
             {
-                out_width = 848;
+                out_width  = 848;
+                phys_width = 848;
+            }
+            else if (strcmp("-geom", argv[a]) == 0 && a + 1 < argc)
+            {
+                int w = 0, h = 0;
+                sscanf(argv[++a], "%dx%d", &w, &h);
+
+                bool found = false;
+                for (const Geometry & g : geometries)
+                {
+                    if (g.w == w && g.h == h)
+                    {
+                        out_width  = g.w;
+                        out_height = g.h;
+                        phys_width = g.phys_w;
+                        found      = true;
+                    }
+                }
+                if (!found)
+                {
+                    printf("Unsupported -geom: %s (320x240, 640x480, 640x240, 848x480, 848x240, 424x240)\n", argv[a]);
+                    exit(EXIT_FAILURE);
+                }
+            }
+            else if (strcmp("-fit", argv[a]) == 0 && a + 1 < argc)
+            {
+                a++;
+                if (strcmp("area", argv[a]) == 0)
+                {
+                    fit_mode = FIT_AREA;
+                }
+                else if (strcmp("lanczos", argv[a]) == 0)
+                {
+                    fit_mode = FIT_LANCZOS;
+                }
+                else if (strcmp("crop", argv[a]) == 0)
+                {
+                    fit_mode = FIT_CROP;
+                }
+                else
+                {
+                    printf("Unsupported -fit: %s (crop, area or lanczos)\n", argv[a]);
+                    exit(EXIT_FAILURE);
+                }
+            }
+            else if (strcmp("-t", argv[a]) == 0)
+            {
+                tile_mode = true;
+            }
+            else if (strcmp("-q", argv[a]) == 0)
+            {
+                quiet = true;
+            }
+            else if (strcmp("-color", argv[a]) == 0)
+            {
+                color = true;
+            }
+            else if (strcmp("-bpp", argv[a]) == 0 && a + 1 < argc)
+            {
+                bpp = atoi(argv[++a]);
+                if (bpp != 4 && bpp != 8)
+                {
+                    printf("Unsupported -bpp: %d (4 or 8)\n", bpp);
+                    exit(EXIT_FAILURE);
+                }
+            }
+            else if (strcmp("-dither", argv[a]) == 0)
+            {
+                dither = true;
+            }
+            else if (strcmp("-frame-pal", argv[a]) == 0)
+            {
+                frame_pal = true;
+            }
+            else if (strcmp("-bench", argv[a]) == 0)
+            {
+                bench = true;
+            }
+            else if (strcmp("-c", argv[a]) == 0)
+            {
+                c_mode = true;
+            }
+            else if (strcmp("-loading", argv[a]) == 0 && a + 1 < argc)
+            {
+                loading = argv[++a];
+            }
+            else if (strcmp("-anim", argv[a]) == 0)
+            {
+                anim_mode = true;
+            }
+            else if (strcmp("-rate", argv[a]) == 0 && a + 1 < argc)
+            {
+                anim_rate = atoi(argv[++a]);
+            }
+            else if (strcmp("-bench-suite", argv[a]) == 0)
+            {
+                bench_suite = true;
+            }
+            else if (strcmp("-synth", argv[a]) == 0 && a + 1 < argc)
+            {
+                synth_geom = argv[++a];
             }
             else
             {
@@ -49,6 +225,10 @@ int main(int argc, char ** argv)
             {
                 out_file = argv[a];
             }
+            else if (tile_mode || bpp || c_mode || bench_suite)
+            {
+                frame_files.push_back(argv[a]);
+            }
             else
             {
                 printf("Unexpected extra argument: '%s'\n", argv[a]);
@@ -57,14 +237,69 @@ int main(int argc, char ** argv)
         }
     }
 
+    if (synth_geom && in_file)
+    {
+        return write_synthetic(synth_geom, in_file);
+    }
+
     if (!in_file || !out_file)
     {
         printf("image_to_mem: Convert image to monochome bitmap file.\n");
-        printf("Usage:  image_to_mem <input font image> <output font mem> [-i]\n");
+        printf("Usage:  image_to_mem <input font image> <output font mem> [-i] [-q]\n");
+        printf("        image_to_mem -t <output dir> <frame images...> [-i]\n");
         printf("   -i   Invert pixels\n");
+        printf("   -geom <WxH>  Output size: 320x240 (default), 640x480, 848x480, or half-height\n");
+        printf("                640x240, 848x240, 424x240 (-848 is 848x240)\n");
+        printf("   -fit <mode>  crop: use the image as-is, cropped or zero padded (default)\n");
+        printf("                area, lanczos: scale to fit (keeping aspect) with that filter\n");
+        printf("   -q   Don't preview the image\n");
+        printf("   -color  Colour: a word (fg/bg attribute + 8 pixels) per 8 pixels, and\n");
+        printf("           palette.xpl (16 RGB444 words) next to the output\n");
+        printf("   -t   Tile mode: dedupe 8x8 cells of all frames into glyphs.xtg,\n");
+        printf("        and write a tilemap per frame (0001.xtm, ...)\n");
+        printf("        image_to_mem -bpp <4|8> <output dir> <frame images...> [-dither] [-frame-pal] [-bench]\n");
+        printf("   -bpp        Indexed colour: quantize all frames to one RGB444 palette (palette.xpl),\n");
+        printf("               and write word-packed frames (0001.x4b / 0001.x8b, ...)\n");
+        printf("   -dither     Floyd-Steinberg dither when mapping to the palette\n");
+        printf("   -frame-pal  Palette per frame (0001.xpl, ...) instead of shared\n");
+        printf("   -bench      Print timings and throughput for each stage\n");
+        printf("        image_to_mem -c <output.c> <frame images...> [-color] [-loading <file>]\n");
+        printf("   -c          Write frames (mono, or -color) as C arrays to link into the demo\n");
+        printf("   -loading    Also embed this loading image (e.g. Disk.pcx) as-is\n");
+        printf("        image_to_mem -anim <output dir> <animated gif/png> [-rate <fps>] [-color] [-i]\n");
+        printf("   -anim       Decode an animated GIF or APNG a frame at a time, writing 0001.xmb, ...\n");
+        printf("               (or .xcb with -color) and delays.txt (ms per frame)\n");
+        printf("   -rate       Retime to a fixed frame rate (e.g. 20 for FRAME_VBLANKS 3) using the delays\n");
+        printf("        image_to_mem -bench-suite <results.csv> <reps> <images...>\n");
+        printf("   -bench-suite  Time decode, pixel fetch, threshold/pack, write and end to end for\n");
+        printf("                 each image (median and p95 of reps), appending to the CSV\n");
+        printf("        image_to_mem -synth <WxH> <output.png>\n");
+        printf("   -synth      Write a synthetic test image (edges, gradients and noise)\n");
         exit(EXIT_FAILURE);
     }
 
+    if (anim_mode)
+    {
+        return write_anim(in_file, out_file);
+    }
+
+    if (bench_suite)
+    {
+        // Positional arguments are the CSV, the repetitions, then the images
+        return run_bench_suite(in_file, std::max(atoi(out_file), 1));
+    }
+
+    if (tile_mode || bpp || c_mode)
+    {
+        // First positional argument is the output directory (or file), the rest are frames
+        frame_files.insert(frame_files.begin(), out_file);
+        if (c_mode)
+        {
+            return write_c_arrays(in_file);
+        }
+        return tile_mode ? write_tiles(in_file) : write_indexed(in_file);
+    }
+
     printf("Input image file     : \"%s\"\n", in_file);
     printf("Output monochrome bitmap file : \"%s\"\n", out_file);
     if (invert)
@@ -73,29 +308,36 @@ int main(int argc, char ** argv)
     }
     printf("\n");
 
-    bool quit = false;
+    bool quit   = false;
+    int  result = EXIT_FAILURE;
 
-    SDL_Init(SDL_INIT_VIDEO);
+    // No preview, no window (so it also runs headless, e.g. from the asset pipeline)
+    SDL_Init(quiet ? 0 : SDL_INIT_VIDEO);
     IMG_Init(IMG_INIT_PNG);
 
-    SDL_Window * window =
-        SDL_CreateWindow("SDL2 Displaying Image", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, 848, 480, 0);
+    SDL_Window *  window = nullptr;
+    SDL_Surface * screen = nullptr;
 
-    if (!window)
+    if (!quiet)
     {
-        printf("*** Can't open SDL window\n");
-        exit(EXIT_FAILURE);
-    }
+        window = SDL_CreateWindow("SDL2 Displaying Image", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, 848, 480, 0);
 
-    SDL_Surface * screen = SDL_GetWindowSurface(window);
-    if (!screen)
-    {
-        printf("*** Can't open SDL window\n");
-        SDL_DestroyWindow(window);
-        SDL_Quit();
+        if (!window)
+        {
+            printf("*** Can't open SDL window\n");
+            exit(EXIT_FAILURE);
+        }
+
+        screen = SDL_GetWindowSurface(window);
+        if (!screen)
+        {
+            printf("*** Can't open SDL window\n");
+            SDL_DestroyWindow(window);
+            SDL_Quit();
+        }
     }
 
-    SDL_Surface * image = IMG_Load(in_file);
+    SDL_Surface * image = load_image(in_file);
 
     int w = 0;
     int h = 0;
@@ -118,7 +360,7 @@ int main(int argc, char ** argv)
     }
 
     // process the image
-    if (!quit)
+    if (!quit && !quiet)
     {
         // show font for a moment
         int spincount = 100;
@@ -151,7 +393,7 @@ int main(int argc, char ** argv)
 
     while (!quit)
     {
-        int        out_size   = (out_width / 8) * out_height;
+        int        out_size   = (out_width / 8) * out_height * (color ? 2 : 1);
         uint8_t  * out_pixels = (uint8_t *)malloc(out_size);
 
         if (!out_pixels)
@@ -160,50 +402,34 @@ int main(int argc, char ** argv)
             break;
         }
 
-        memset(out_pixels, 0, out_size);
-        uint8_t * pptr = out_pixels;
-
         FILE * fp = fopen(out_file, "w");
         if (fp != nullptr)
         {
             printf("Writing output: \"%s\" %d x %d...\n", out_file, out_width, out_height);
 
-            for (int y = 0; y < out_height; y++)
+            if (color)
             {
-                for (int x = 0; x < out_width; x += 8)
-                {
-                    uint8_t val = 0;
-                    if (y < h && x < w)
-                    {
-                        for (int b = 0; b < 8; b++)
-                        {
-                            SDL_Color rgb;
-                            Uint32    data = getpixel(image, x + b, y);
-                            SDL_GetRGB(data, image->format, &rgb.r, &rgb.g, &rgb.b);
-                            int v = (rgb.r + rgb.g + rgb.b) / 3;
-
-                            bool pixel = (v >= 128);
-                            if (invert)
-                            {
-                                pixel = !pixel;
-                            }
-
-                            if (pixel)
-                            {
-                                val |= (0x80 >> b);
-                            }
-                        }
-                    }
-
-                    *pptr++ = val; // (val << 8) | 0x0F;        // big-endian!
-                }
+                image_to_color(image, out_pixels);
+            }
+            else
+            {
+                image_to_mono(image, out_pixels);
             }
 
             bool good = (fwrite(out_pixels, out_size, 1, fp) == 1);
 
+            if (good && color)
+            {
+                good = write_palette(out_file);
+            }
+
             fclose(fp);
 
             printf(good ? "Success.\n" : "Failed to write");
+            if (good)
+            {
+                result = EXIT_SUCCESS;
+            }
         }
         else
         {
@@ -217,12 +443,1994 @@ int main(int argc, char ** argv)
     {
         SDL_FreeSurface(image);
     }
-    SDL_DestroyWindow(window);
+    if (window)
+    {
+        SDL_DestroyWindow(window);
+    }
 
     IMG_Quit();
     SDL_Quit();
 
-    return 0;
+    return result;
+}
+
+// Threshold one pixel's brightness (0-255)
+static inline bool mono_pixel(int v)
+{
+    bool pixel = (v >= 128);
+    return invert ? !pixel : pixel;
+}
+
+// Threshold image to out_width x out_height 1bpp, MSB leftmost (anything outside the image is 0)
+void image_to_mono(SDL_Surface * image, uint8_t * out_pixels)
+{
+    uint8_t * pptr = out_pixels;
+
+    for (int y = 0; y < out_height; y++)
+    {
+        for (int x = 0; x < out_width; x += 8)
+        {
+            uint8_t val = 0;
+            if (y < image->h)
+            {
+                // Width needn't be a multiple of 8 (e.g. -anim canvases), so stop at the edge
+                for (int b = 0; b < 8 && x + b < image->w; b++)
+                {
+                    SDL_Color rgb;
+                    Uint32    data = getpixel(image, x + b, y);
+                    SDL_GetRGB(data, image->format, &rgb.r, &rgb.g, &rgb.b);
+                    int v = (rgb.r + rgb.g + rgb.b) / 3;
+
+                    if (mono_pixel(v))
+                    {
+                        val |= (0x80 >> b);
+                    }
+                }
+            }
+
+            *pptr++ = val; // (val << 8) | 0x0F;        // big-endian!
+        }
+    }
+}
+
+static void get_rgb(SDL_Surface * image, int x, int y, int rgb[3])
+{
+    SDL_Color c = {0, 0, 0, 0};
+    if (x < image->w && y < image->h)
+    {
+        SDL_GetRGB(getpixel(image, x, y), image->format, &c.r, &c.g, &c.b);
+    }
+    rgb[0] = c.r;
+    rgb[1] = c.g;
+    rgb[2] = c.b;
+}
+
+static int color_error(const int rgb[3], int index)
+{
+    int err = 0;
+    for (int c = 0; c < 3; c++)
+    {
+        int d = rgb[c] - ((color_palette[index] >> (8 - c * 4)) & 0xF) * 17;
+        err += d * d;
+    }
+    return err;
+}
+
+/*
+ * For each 8 pixel cell, pick the foreground/background pair from
+ * color_palette that matches best (each pixel taking whichever of the
+ * two is closer). Output is big-endian words: fg << 12 | bg << 8 | bits,
+ * where a set bit is foreground.
+ */
+void image_to_color(SDL_Surface * image, uint8_t * out_words)
+{
+    uint8_t * wptr = out_words;
+
+    for (int y = 0; y < out_height; y++)
+    {
+        for (int x = 0; x < out_width; x += 8)
+        {
+            int err[8][16];
+            for (int b = 0; b < 8; b++)
+            {
+                int rgb[3];
+                get_rgb(image, x + b, y, rgb);
+                for (int i = 0; i < 16; i++)
+                {
+                    err[b][i] = color_error(rgb, i);
+                }
+            }
+
+            int best_err = INT32_MAX;
+            int best_fg  = 15;
+            int best_bg  = 0;
+
+            for (int fg = 0; fg < 16; fg++)
+            {
+                for (int bg = 0; bg <= fg; bg++)
+                {
+                    int total = 0;
+                    for (int b = 0; b < 8; b++)
+                    {
+                        total += std::min(err[b][fg], err[b][bg]);
+                    }
+
+                    if (total < best_err)
+                    {
+                        best_err = total;
+                        best_fg  = fg;
+                        best_bg  = bg;
+                    }
+                }
+            }
+
+            uint8_t bits = 0;
+            for (int b = 0; b < 8; b++)
+            {
+                if (err[b][best_fg] < err[b][best_bg])
+                {
+                    bits |= (0x80 >> b);
+                }
+            }
+
+            *wptr++ = (best_fg << 4) | best_bg;        // big-endian!
+            *wptr++ = bits;
+        }
+    }
+}
+
+static bool write_file(const char * path, const void * data, size_t size)
+{
+    FILE * fp = fopen(path, "wb");
+    if (!fp)
+    {
+        printf("*** Unable to open write to output file \"%s\"\n", path);
+        return false;
+    }
+
+    bool good = (fwrite(data, size, 1, fp) == 1);
+    fclose(fp);
+
+    if (!good)
+    {
+        printf("*** Failed to write \"%s\"\n", path);
+    }
+    return good;
+}
+
+// Write color_palette as palette.xpl (16 big-endian words) in the same directory as out_file
+bool write_palette(const char * out_file)
+{
+    char         path[4096];
+    const char * slash = strrchr(out_file, '/');
+    int          dir   = slash ? (int)(slash - out_file) + 1 : 0;
+
+    snprintf(path, sizeof(path), "%.*spalette.xpl", dir, out_file);
+
+    uint8_t words[32];
+    for (int i = 0; i < 16; i++)
+    {
+        words[i * 2]     = color_palette[i] >> 8;
+        words[i * 2 + 1] = color_palette[i] & 0xFF;
+    }
+
+    printf("Writing palette: \"%s\"\n", path);
+    return write_file(path, words, sizeof(words));
+}
+
+/*
+ * Cut every frame into 8x8 cells, and dedupe the cells across all frames
+ * into one glyph set. If there are more than MAX_GLYPHS distinct cells,
+ * the most used are kept, and the rest map to their nearest kept glyph
+ * (fewest differing pixels). Glyph 0 is always the empty cell.
+ *
+ * Writes <out_dir>/glyphs.xtg (8 bytes per glyph, top row first) and
+ * <out_dir>/NNNN.xtm (one glyph index byte per cell, row-major).
+ */
+int write_tiles(const char * out_dir)
+{
+    int cols      = out_width / 8;
+    int rows      = out_height / 8;
+    int out_size  = cols * out_height;
+    int map_size  = cols * rows;
+    int num_cells = 0;
+
+    std::vector<uint8_t>                   mono(out_size);
+    std::vector<std::vector<uint64_t>>     frames;
+    std::unordered_map<uint64_t, uint32_t> counts;
+
+    counts[0] = 0;
+
+    for (char * file : frame_files)
+    {
+        SDL_Surface * image = load_image(file);
+        if (!image)
+        {
+            printf("*** Unable to load \"%s\"\n", file);
+            return EXIT_FAILURE;
+        }
+
+        image_to_mono(image, mono.data());
+        SDL_FreeSurface(image);
+
+        std::vector<uint64_t> cells(map_size);
+        for (int cy = 0; cy < rows; cy++)
+        {
+            for (int cx = 0; cx < cols; cx++)
+            {
+                uint64_t cell = 0;
+                for (int r = 0; r < 8; r++)
+                {
+                    cell = (cell << 8) | mono[(cy * 8 + r) * cols + cx];
+                }
+                cells[cy * cols + cx] = cell;
+                counts[cell]++;
+            }
+        }
+
+        num_cells += map_size;
+        frames.push_back(cells);
+    }
+
+    // Most used first, but the empty cell is always glyph 0
+    std::vector<std::pair<uint32_t, uint64_t>> by_use;
+    for (auto & c : counts)
+    {
+        by_use.push_back(std::make_pair(c.first == 0 ? UINT32_MAX : c.second, c.first));
+    }
+    std::sort(by_use.begin(),
+              by_use.end(),
+              [](const std::pair<uint32_t, uint64_t> & a, const std::pair<uint32_t, uint64_t> & b) {
+                  return a.first != b.first ? a.first > b.first : a.second < b.second;
+              });
+
+    int                                   num_glyphs = std::min((int)by_use.size(), MAX_GLYPHS);
+    std::vector<uint64_t>                 glyphs;
+    std::unordered_map<uint64_t, uint8_t> index;
+    int                                   merged = 0;
+
+    for (int g = 0; g < num_glyphs; g++)
+    {
+        glyphs.push_back(by_use[g].second);
+        index[by_use[g].second] = g;
+    }
+
+    for (size_t u = num_glyphs; u < by_use.size(); u++)
+    {
+        uint64_t cell = by_use[u].second;
+        int      best = 0;
+        int      dist = 65;
+
+        for (int g = 0; g < num_glyphs; g++)
+        {
+            int d = __builtin_popcountll(cell ^ glyphs[g]);
+            if (d < dist)
+            {
+                dist = d;
+                best = g;
+            }
+        }
+
+        index[cell] = best;
+        merged++;
+    }
+
+    printf("%d frames, %d cells, %d distinct, %d glyphs", (int)frames.size(), num_cells, (int)by_use.size(), num_glyphs);
+    if (merged)
+    {
+        printf(" (%d merged with nearest - lossy!)", merged);
+    }
+    printf("\n");
+
+    char path[4096];
+
+    std::vector<uint8_t> glyph_bytes;
+    for (uint64_t g : glyphs)
+    {
+        for (int r = 7; r >= 0; r--)
+        {
+            glyph_bytes.push_back((g >> (r * 8)) & 0xFF);
+        }
+    }
+
+    snprintf(path, sizeof(path), "%s/glyphs.xtg", out_dir);
+    printf("Writing output: \"%s\" %d glyphs (%d words of tile memory)...\n", path, num_glyphs, num_glyphs * 4);
+    if (!write_file(path, glyph_bytes.data(), glyph_bytes.size()))
+    {
+        return EXIT_FAILURE;
+    }
+
+    std::vector<uint8_t> map(map_size);
+    for (size_t f = 0; f < frames.size(); f++)
+    {
+        for (int i = 0; i < map_size; i++)
+        {
+            map[i] = index[frames[f][i]];
+        }
+
+        snprintf(path, sizeof(path), "%s/%04d.xtm", out_dir, (int)f + 1);
+        if (!write_file(path, map.data(), map.size()))
+        {
+            return EXIT_FAILURE;
+        }
+    }
+
+    printf("Wrote %d tilemaps of %d bytes (bitmap frames are %d bytes).\nSuccess.\n",
+           (int)frames.size(),
+           map_size,
+           out_size);
+
+    return EXIT_SUCCESS;
+}
+
+/*
+ * Indexed colour quantizer
+ *
+ * Pixels are counted into a 4096 entry RGB444 histogram (the most
+ * Xosera can show anyway), which is median-cut into the palette. Mapping
+ * goes through a 4096 entry lookup table of nearest palette entries,
+ * so it's independent of palette size. Histogram, table and (undithered)
+ * mapping are split across threads.
+ */
+typedef std::chrono::steady_clock bench_clock;
+
+struct RgbImage
+{
+    std::vector<uint8_t> rgb;        // out_width x out_height x 3
+};
+
+struct Box
+{
+    std::vector<uint16_t> colors;        // RGB444 histogram entries in this box
+    uint64_t              count;
+};
+
+static unsigned num_threads()
+{
+    unsigned n = std::thread::hardware_concurrency();
+    return n ? n : 1;
+}
+
+// Run fn(begin, end) over [0, n) split across threads
+static void parallel_for(int n, const std::function<void(int, int)> & fn)
+{
+    int                      parts = std::min((int)num_threads(), n);
+    std::vector<std::thread> threads;
+
+    for (int t = 1; t < parts; t++)
+    {
+        threads.emplace_back(fn, n * t / parts, n * (t + 1) / parts);
+    }
+    fn(0, parts ? n / parts : n);
+
+    for (auto & t : threads)
+    {
+        t.join();
+    }
+}
+
+static inline uint16_t to_rgb444(const uint8_t * p)
+{
+    return ((p[0] >> 4) << 8) | ((p[1] >> 4) << 4) | (p[2] >> 4);
+}
+
+static inline int channel(uint16_t rgb444, int c)
+{
+    return (rgb444 >> (8 - c * 4)) & 0xF;
+}
+
+static bool load_rgb(const char * file, RgbImage & out)
+{
+    SDL_Surface * image = load_image(file);
+    if (!image)
+    {
+        printf("*** Unable to load \"%s\"\n", file);
+        return false;
+    }
+
+    SDL_Surface * rgb = SDL_ConvertSurfaceFormat(image, SDL_PIXELFORMAT_RGB24, 0);
+    SDL_FreeSurface(image);
+    if (!rgb)
+    {
+        printf("*** Unable to convert \"%s\": %s\n", file, SDL_GetError());
+        return false;
+    }
+
+    out.rgb.assign(out_width * out_height * 3, 0);
+
+    SDL_LockSurface(rgb);
+    int copy_w = std::min(rgb->w, out_width) * 3;
+    for (int y = 0; y < std::min(rgb->h, out_height); y++)
+    {
+        memcpy(&out.rgb[y * out_width * 3], (uint8_t *)rgb->pixels + y * rgb->pitch, copy_w);
+    }
+    SDL_UnlockSurface(rgb);
+    SDL_FreeSurface(rgb);
+
+    if (invert)
+    {
+        for (auto & v : out.rgb)
+        {
+            v = 255 - v;
+        }
+    }
+
+    return true;
+}
+
+static void add_histogram(const RgbImage & image, std::vector<uint64_t> & hist)
+{
+    std::mutex merge;
+
+    parallel_for(out_width * out_height, [&](int begin, int end) {
+        std::vector<uint64_t> local(4096, 0);
+        for (int i = begin; i < end; i++)
+        {
+            local[to_rgb444(&image.rgb[i * 3])]++;
+        }
+
+        std::lock_guard<std::mutex> lock(merge);
+        for (int i = 0; i < 4096; i++)
+        {
+            hist[i] += local[i];
+        }
+    });
+}
+
+// Median cut the histogram into at most max_colors RGB444 entries
+static std::vector<uint16_t> median_cut(const std::vector<uint64_t> & hist, int max_colors)
+{
+    std::vector<Box> boxes(1);
+    for (int i = 0; i < 4096; i++)
+    {
+        if (hist[i])
+        {
+            boxes[0].colors.push_back(i);
+            boxes[0].count += hist[i];
+        }
+    }
+
+    while ((int)boxes.size() < max_colors)
+    {
+        // Split the box with the widest channel range (weighted by pixels in it)
+        int      split   = -1;
+        int      axis    = 0;
+        uint64_t best    = 0;
+
+        for (size_t b = 0; b < boxes.size(); b++)
+        {
+            if (boxes[b].colors.size() < 2)
+            {
+                continue;
+            }
+
+            for (int c = 0; c < 3; c++)
+            {
+                int lo = 15, hi = 0;
+                for (uint16_t col : boxes[b].colors)
+                {
+                    lo = std::min(lo, channel(col, c));
+                    hi = std::max(hi, channel(col, c));
+                }
+
+                uint64_t score = (uint64_t)(hi - lo) * boxes[b].count;
+                if (hi > lo && score >= best)
+                {
+                    best  = score;
+                    split = b;
+                    axis  = c;
+                }
+            }
+        }
+
+        if (split < 0)
+        {
+            break;        // Every box is a single colour
+        }
+
+        Box & box = boxes[split];
+        std::sort(box.colors.begin(), box.colors.end(), [axis](uint16_t a, uint16_t b) {
+            return channel(a, axis) < channel(b, axis);
+        });
+
+        // Split at the weighted median, keeping at least one colour each side
+        uint64_t half = box.count / 2, seen = 0;
+        size_t   at   = 1;
+        for (; at < box.colors.size() - 1; at++)
+        {
+            seen += hist[box.colors[at - 1]];
+            if (seen >= half)
+            {
+                break;
+            }
+        }
+
+        Box other;
+        other.colors.assign(box.colors.begin() + at, box.colors.end());
+        box.colors.resize(at);
+        other.count = 0;
+        for (uint16_t col : other.colors)
+        {
+            other.count += hist[col];
+        }
+        box.count -= other.count;
+        boxes.push_back(other);
+    }
+
+    std::vector<uint16_t> palette;
+    for (auto & box : boxes)
+    {
+        uint64_t sum[3] = {0, 0, 0};
+        for (uint16_t col : box.colors)
+        {
+            for (int c = 0; c < 3; c++)
+            {
+                sum[c] += channel(col, c) * hist[col];
+            }
+        }
+
+        uint16_t entry = 0;
+        for (int c = 0; c < 3; c++)
+        {
+            entry |= (box.count ? (sum[c] + box.count / 2) / box.count : 0) << (8 - c * 4);
+        }
+        palette.push_back(entry);
+    }
+
+    palette.resize(max_colors, 0);
+    return palette;
+}
+
+// Nearest palette entry for every RGB444 colour
+static std::vector<uint8_t> build_lut(const std::vector<uint16_t> & palette)
+{
+    std::vector<uint8_t> lut(4096);
+
+    parallel_for(4096, [&](int begin, int end) {
+        for (int i = begin; i < end; i++)
+        {
+            int best = 0, best_err = INT32_MAX;
+            for (size_t p = 0; p < palette.size(); p++)
+            {
+                int err = 0;
+                for (int c = 0; c < 3; c++)
+                {
+                    int d = channel(i, c) - channel(palette[p], c);
+                    err += d * d;
+                }
+                if (err < best_err)
+                {
+                    best_err = err;
+                    best     = p;
+                }
+            }
+            lut[i] = best;
+        }
+    });
+
+    return lut;
+}
+
+static void map_pixels(const RgbImage &               image,
+                       const std::vector<uint16_t> &  palette,
+                       const std::vector<uint8_t> &   lut,
+                       std::vector<uint8_t> &         out)
+{
+    int pixels = out_width * out_height;
+    out.resize(pixels);
+
+    if (!dither)
+    {
+        parallel_for(pixels, [&](int begin, int end) {
+            for (int i = begin; i < end; i++)
+            {
+                out[i] = lut[to_rgb444(&image.rgb[i * 3])];
+            }
+        });
+        return;
+    }
+
+    // Floyd-Steinberg, in 8 bit per channel (errors carried in a two line buffer)
+    std::vector<int> err((out_width + 2) * 2 * 3, 0);
+    for (int y = 0; y < out_height; y++)
+    {
+        int * cur  = &err[((y & 1) * (out_width + 2) + 1) * 3];
+        int * next = &err[((~y & 1) * (out_width + 2) + 1) * 3];
+        std::fill(next - 3, next + (out_width + 1) * 3, 0);
+
+        for (int x = 0; x < out_width; x++)
+        {
+            const uint8_t * src = &image.rgb[(y * out_width + x) * 3];
+            uint8_t         want[3];
+
+            for (int c = 0; c < 3; c++)
+            {
+                want[c] = std::min(255, std::max(0, src[c] + cur[x * 3 + c] / 16));
+            }
+
+            uint8_t index = lut[to_rgb444(want)];
+            out[y * out_width + x] = index;
+
+            for (int c = 0; c < 3; c++)
+            {
+                int e = want[c] - channel(palette[index], c) * 17;
+                cur[(x + 1) * 3 + c] += e * 7;
+                next[(x - 1) * 3 + c] += e * 3;
+                next[x * 3 + c] += e * 5;
+                next[(x + 1) * 3 + c] += e;
+            }
+        }
+    }
+}
+
+// Pack indices into big-endian words, leftmost pixel in the high bits
+static std::vector<uint8_t> pack_words(const std::vector<uint8_t> & indices)
+{
+    std::vector<uint8_t> out;
+
+    if (bpp == 8)
+    {
+        out = indices;        // Two pixels per word is already big-endian byte order
+    }
+    else
+    {
+        for (size_t i = 0; i < indices.size(); i += 2)
+        {
+            out.push_back((indices[i] << 4) | (indices[i + 1] & 0xF));
+        }
+    }
+
+    return out;
+}
+
+static bool write_palette_file(const char * path, const std::vector<uint16_t> & palette)
+{
+    std::vector<uint8_t> words;
+    for (uint16_t entry : palette)
+    {
+        words.push_back(entry >> 8);
+        words.push_back(entry & 0xFF);
+    }
+
+    return write_file(path, words.data(), words.size());
+}
+
+static double seconds_since(bench_clock::time_point start)
+{
+    return std::chrono::duration<double>(bench_clock::now() - start).count();
+}
+
+/*
+ * Quantize all frames (with one shared palette, unless -frame-pal) and
+ * write <out_dir>/palette.xpl and <out_dir>/NNNN.x4b or .x8b.
+ */
+int write_indexed(const char * out_dir)
+{
+    int    colors = 1 << bpp;
+    double t_load = 0, t_hist = 0, t_cut = 0, t_map = 0;
+    char   path[4096];
+
+    std::vector<RgbImage> frames(frame_files.size());
+    std::vector<uint64_t> hist(4096, 0);
+
+    for (size_t f = 0; f < frames.size(); f++)
+    {
+        auto start = bench_clock::now();
+        if (!load_rgb(frame_files[f], frames[f]))
+        {
+            return EXIT_FAILURE;
+        }
+        t_load += seconds_since(start);
+
+        if (!frame_pal)
+        {
+            start = bench_clock::now();
+            add_histogram(frames[f], hist);
+            t_hist += seconds_since(start);
+        }
+    }
+
+    std::vector<uint16_t> palette;
+    std::vector<uint8_t>  lut;
+
+    if (!frame_pal)
+    {
+        auto start = bench_clock::now();
+        palette    = median_cut(hist, colors);
+        lut        = build_lut(palette);
+        t_cut += seconds_since(start);
+
+        snprintf(path, sizeof(path), "%s/palette.xpl", out_dir);
+        printf("Writing palette: \"%s\" %d colours\n", path, colors);
+        if (!write_palette_file(path, palette))
+        {
+            return EXIT_FAILURE;
+        }
+    }
+
+    std::vector<uint8_t> indices;
+    for (size_t f = 0; f < frames.size(); f++)
+    {
+        if (frame_pal)
+        {
+            auto start = bench_clock::now();
+            std::fill(hist.begin(), hist.end(), 0);
+            add_histogram(frames[f], hist);
+            t_hist += seconds_since(start);
+
+            start   = bench_clock::now();
+            palette = median_cut(hist, colors);
+            lut     = build_lut(palette);
+            t_cut += seconds_since(start);
+
+            snprintf(path, sizeof(path), "%s/%04d.xpl", out_dir, (int)f + 1);
+            if (!write_palette_file(path, palette))
+            {
+                return EXIT_FAILURE;
+            }
+        }
+
+        auto start = bench_clock::now();
+        map_pixels(frames[f], palette, lut, indices);
+        t_map += seconds_since(start);
+
+        std::vector<uint8_t> packed = pack_words(indices);
+        snprintf(path, sizeof(path), "%s/%04d.x%db", out_dir, (int)f + 1, bpp);
+        if (!write_file(path, packed.data(), packed.size()))
+        {
+            return EXIT_FAILURE;
+        }
+    }
+
+    printf("Wrote %d frames of %d x %d at %d bpp (%d bytes each).\n",
+           (int)frames.size(),
+           out_width,
+           out_height,
+           bpp,
+           out_width * out_height * bpp / 8);
+
+    if (bench)
+    {
+        double mpix = (double)frames.size() * out_width * out_height / 1e6;
+
+        printf("Benchmark (%u threads, %.2f Mpixels):\n", num_threads(), mpix);
+        printf("  load        %8.2f ms\n", t_load * 1e3);
+        printf("  histogram   %8.2f ms  %8.1f Mpixels/s\n", t_hist * 1e3, t_hist > 0 ? mpix / t_hist : 0.0);
+        printf("  median cut  %8.2f ms\n", t_cut * 1e3);
+        printf("  map%s  %8.2f ms  %8.1f Mpixels/s\n", dither ? "+dither" : "        ", t_map * 1e3, t_map > 0 ? mpix / t_map : 0.0);
+    }
+
+    printf("Success.\n");
+    return EXIT_SUCCESS;
+}
+
+static void write_c_bytes(FILE * fp, const uint8_t * data, size_t size)
+{
+    for (size_t i = 0; i < size; i++)
+    {
+        fprintf(fp, "%s0x%02x,", (i % 16) ? " " : "\n    ", data[i]);
+    }
+    fprintf(fp, "\n");
+}
+
+/*
+ * Write all frames (mono, or -color attribute words) as one C source
+ * to link into the demo (see embedded_frames.h). Frames are stored
+ * back to back, with a table of byte offsets.
+ */
+int write_c_arrays(const char * out_c)
+{
+    int frame_size = (out_width / 8) * out_height * (color ? 2 : 1);
+
+    FILE * fp = fopen(out_c, "w");
+    if (!fp)
+    {
+        printf("*** Unable to open write to output file \"%s\"\n", out_c);
+        return EXIT_FAILURE;
+    }
+
+    printf("Writing output: \"%s\" %d frames of %d bytes...\n", out_c, (int)frame_files.size(), frame_size);
+
+    fprintf(fp, "// Generated by image_to_monobitmap -c - do not edit\n");
+    fprintf(fp, "// %s frames, %d x %d\n\n", color ? "Colour" : "Mono", out_width, out_height);
+    fprintf(fp, "#include <stdint.h>\n\n");
+    fprintf(fp, "const uint16_t embedded_frame_count = %d;\n", (int)frame_files.size());
+    fprintf(fp, "const uint32_t embedded_frame_size = %d;\n\n", frame_size);
+
+    std::vector<uint8_t> frame(frame_size);
+
+    fprintf(fp, "const uint8_t embedded_frames[] __attribute__((aligned(4))) = {");
+    for (char * file : frame_files)
+    {
+        SDL_Surface * image = load_image(file);
+        if (!image)
+        {
+            printf("*** Unable to load \"%s\"\n", file);
+            fclose(fp);
+            return EXIT_FAILURE;
+        }
+
+        if (color)
+        {
+            image_to_color(image, frame.data());
+        }
+        else
+        {
+            image_to_mono(image, frame.data());
+        }
+        SDL_FreeSurface(image);
+
+        fprintf(fp, "\n    // %s", file);
+        write_c_bytes(fp, frame.data(), frame.size());
+    }
+    fprintf(fp, "};\n\n");
+
+    fprintf(fp, "const uint16_t embedded_palette[16] = {");
+    for (int i = 0; i < 16; i++)
+    {
+        fprintf(fp, "%s0x%04x,", (i % 8) ? " " : "\n    ", color ? color_palette[i] : 0);
+    }
+    fprintf(fp, "\n};\n\n");
+
+    std::vector<uint8_t> loading_data;
+    if (loading)
+    {
+        FILE * lp = fopen(loading, "rb");
+        if (!lp)
+        {
+            printf("*** Unable to open loading image \"%s\"\n", loading);
+            fclose(fp);
+            return EXIT_FAILURE;
+        }
+
+        uint8_t buf[4096];
+        size_t  got;
+        while ((got = fread(buf, 1, sizeof(buf), lp)) > 0)
+        {
+            loading_data.insert(loading_data.end(), buf, buf + got);
+        }
+        fclose(lp);
+    }
+
+    fprintf(fp, "const uint32_t embedded_loading_size = %u;\n", (unsigned)loading_data.size());
+    fprintf(fp, "const uint8_t embedded_loading[] = {");
+    if (loading_data.empty())
+    {
+        fprintf(fp, "0};\n");        // C doesn't allow empty arrays
+    }
+    else
+    {
+        write_c_bytes(fp, loading_data.data(), loading_data.size());
+        fprintf(fp, "};\n");
+    }
+
+    bool good = !ferror(fp);
+    fclose(fp);
+
+    printf(good ? "Success.\n" : "Failed to write\n");
+    return good ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/*
+ * Resampling to the output geometry (-fit area / lanczos)
+ *
+ * The image is scaled to fit out_width x out_height keeping its aspect
+ * (allowing for non-square pixels in the half-height modes), centred,
+ * with black borders. It's separable: a horizontal pass over every
+ * source row into a float buffer, then a vertical pass into the
+ * output, each split across threads by rows. Pixels are premultiplied
+ * RGBA in linear light, held in a 4-float vector (a GCC/Clang vector
+ * extension) so each filter tap is one SIMD multiply-add.
+ */
+typedef float v4f __attribute__((vector_size(16)));
+
+// Source pixels (from first) and their weights for one output pixel
+struct Taps
+{
+    int                first = 0;
+    std::vector<float> weights;
+};
+
+static const double PI             = 3.14159265358979323846;
+static const int    LANCZOS_LOBES  = 3;
+static const int    TO_SRGB_STEPS  = 4096;
+
+static float srgb_to_linear[256];
+static uint8_t linear_to_srgb[TO_SRGB_STEPS + 1];
+
+static void init_gamma()
+{
+    static std::once_flag once;
+    std::call_once(once, []() {
+        for (int i = 0; i < 256; i++)
+        {
+            double c          = i / 255.0;
+            srgb_to_linear[i] = (float)(c <= 0.04045 ? c / 12.92 : pow((c + 0.055) / 1.055, 2.4));
+        }
+        for (int i = 0; i <= TO_SRGB_STEPS; i++)
+        {
+            double c          = (double)i / TO_SRGB_STEPS;
+            c                 = c <= 0.0031308 ? c * 12.92 : 1.055 * pow(c, 1 / 2.4) - 0.055;
+            linear_to_srgb[i] = (uint8_t)lround(c * 255);
+        }
+    });
+}
+
+static double sinc(double x)
+{
+    return x == 0 ? 1.0 : sin(PI * x) / (PI * x);
+}
+
+// Filter taps mapping src_len source pixels onto dst_len output pixels
+static std::vector<Taps> make_taps(int src_len, int dst_len)
+{
+    std::vector<Taps> taps(dst_len);
+    double            scale   = (double)src_len / dst_len;
+    double            stretch = std::max(scale, 1.0);        // Widen the kernel when shrinking
+
+    for (int i = 0; i < dst_len; i++)
+    {
+        double center = (i + 0.5) * scale;
+        double lo     = i * scale;
+        double hi     = (i + 1) * scale;
+
+        if (fit_mode == FIT_LANCZOS)
+        {
+            lo = center - LANCZOS_LOBES * stretch;
+            hi = center + LANCZOS_LOBES * stretch;
+        }
+
+        int    first = std::max((int)floor(lo), 0);
+        int    last  = std::min((int)ceil(hi), src_len) - 1;
+        double total = 0;
+
+        for (int j = first; j <= last; j++)
+        {
+            double w;
+            if (fit_mode == FIT_AREA)
+            {
+                w = std::min(hi, j + 1.0) - std::max(lo, (double)j);        // Coverage
+            }
+            else
+            {
+                double x = (j + 0.5 - center) / stretch;
+                w        = fabs(x) < LANCZOS_LOBES ? sinc(x) * sinc(x / LANCZOS_LOBES) : 0;
+            }
+            taps[i].weights.push_back((float)w);
+            total += w;
+        }
+
+        taps[i].first = first;
+        for (float & w : taps[i].weights)
+        {
+            w = total != 0 ? (float)(w / total) : 0;
+        }
+    }
+
+    return taps;
+}
+
+// Load an image, fitted to the output geometry if -fit asks for it
+SDL_Surface * load_image(const char * file)
+{
+    SDL_Surface * image = IMG_Load(file);
+    if (!image || fit_mode == FIT_CROP)
+    {
+        return image;
+    }
+
+    SDL_Surface * fitted = fit_surface(image);
+    SDL_FreeSurface(image);
+    return fitted;
+}
+
+// Returns a new out_width x out_height RGBA32 surface with image fitted in it
+SDL_Surface * fit_surface(SDL_Surface * image)
+{
+    auto start = bench_clock::now();
+
+    init_gamma();
+
+    SDL_Surface * src = SDL_ConvertSurfaceFormat(image, SDL_PIXELFORMAT_RGBA32, 0);
+    SDL_Surface * dst = SDL_CreateRGBSurfaceWithFormat(0, out_width, out_height, 32, SDL_PIXELFORMAT_RGBA32);
+    if (!src || !dst)
+    {
+        printf("*** Unable to create surface: %s\n", SDL_GetError());
+        if (src)
+        {
+            SDL_FreeSurface(src);
+        }
+        return nullptr;
+    }
+
+    // Display units (640 or 848 x 480) per output pixel, and per source pixel
+    int    sw    = src->w;
+    int    sh    = src->h;
+    double px_w  = (double)phys_width / out_width;
+    double px_h  = 480.0 / out_height;
+    double scale = std::min(phys_width / (double)sw, 480.0 / sh);
+    int    dw    = std::max(1, std::min(out_width, (int)lround(sw * scale / px_w)));
+    int    dh    = std::max(1, std::min(out_height, (int)lround(sh * scale / px_h)));
+    int    dx    = (out_width - dw) / 2;
+    int    dy    = (out_height - dh) / 2;
+
+    std::vector<Taps> h_taps = make_taps(sw, dw);
+    std::vector<Taps> v_taps = make_taps(sh, dh);
+    std::vector<v4f>  rows((size_t)sh * dw);
+
+    SDL_LockSurface(src);
+    SDL_LockSurface(dst);
+
+    parallel_for(sh, [&](int begin, int end) {
+        std::vector<v4f> line(sw);
+        for (int y = begin; y < end; y++)
+        {
+            const uint8_t * p = (const uint8_t *)src->pixels + y * src->pitch;
+            for (int x = 0; x < sw; x++, p += 4)
+            {
+                float a = p[3] * (1.0f / 255);
+                line[x] = v4f{srgb_to_linear[p[0]] * a, srgb_to_linear[p[1]] * a, srgb_to_linear[p[2]] * a, a};
+            }
+
+            v4f * out = &rows[(size_t)y * dw];
+            for (int x = 0; x < dw; x++)
+            {
+                const Taps & t   = h_taps[x];
+                const v4f *  in  = &line[t.first];
+                v4f          acc = {0, 0, 0, 0};
+                for (size_t k = 0; k < t.weights.size(); k++)
+                {
+                    acc += in[k] * t.weights[k];
+                }
+                out[x] = acc;
+            }
+        }
+    });
+
+    parallel_for(dh, [&](int begin, int end) {
+        std::vector<v4f> acc(dw);
+        for (int y = begin; y < end; y++)
+        {
+            const Taps & t = v_taps[y];
+            std::fill(acc.begin(), acc.end(), v4f{0, 0, 0, 0});
+            for (size_t k = 0; k < t.weights.size(); k++)
+            {
+                const v4f * in = &rows[(size_t)(t.first + k) * dw];
+                float       w  = t.weights[k];
+                for (int x = 0; x < dw; x++)
+                {
+                    acc[x] += in[x] * w;
+                }
+            }
+
+            // Over black (the border colour), back to sRGB
+            uint8_t * p = (uint8_t *)dst->pixels + (y + dy) * dst->pitch + dx * 4;
+            for (int x = 0; x < dw; x++, p += 4)
+            {
+                for (int c = 0; c < 3; c++)
+                {
+                    float v = std::min(std::max(acc[x][c], 0.0f), 1.0f);
+                    p[c]    = linear_to_srgb[(int)(v * TO_SRGB_STEPS + 0.5f)];
+                }
+                p[3] = 255;
+            }
+        }
+    });
+
+    // Borders
+    for (int y = 0; y < out_height; y++)
+    {
+        uint8_t * p = (uint8_t *)dst->pixels + y * dst->pitch;
+        for (int x = 0; x < out_width; x++)
+        {
+            bool inside = y >= dy && y < dy + dh && x >= dx && x < dx + dw;
+            if (!inside)
+            {
+                p[x * 4 + 0] = p[x * 4 + 1] = p[x * 4 + 2] = 0;
+                p[x * 4 + 3] = 255;
+            }
+        }
+    }
+
+    SDL_UnlockSurface(dst);
+    SDL_UnlockSurface(src);
+    SDL_FreeSurface(src);
+
+    if (bench)
+    {
+        printf("Fit %d x %d -> %d x %d (%s): %.2f ms\n",
+               sw,
+               sh,
+               dw,
+               dh,
+               fit_mode == FIT_AREA ? "area" : "lanczos",
+               seconds_since(start) * 1000);
+    }
+
+    return dst;
+}
+
+/*
+ * Animated input (GIF and APNG)
+ *
+ * Both are decoded a frame at a time from the file, composited onto an
+ * RGBA canvas (honouring each frame's disposal), and handed to the frame
+ * writer with the frame's delay. Only the canvas, a saved copy for
+ * "restore previous" disposal and one frame's data are ever in memory.
+ * GIFs are LZW-decoded here; APNG frames are repackaged as standalone
+ * PNGs and decoded by SDL_image.
+ */
+struct AnimCanvas
+{
+    int                  w = 0;
+    int                  h = 0;
+    std::vector<uint8_t> rgba;
+    std::vector<uint8_t> saved;
+};
+
+struct Rect
+{
+    int x = 0, y = 0, w = 0, h = 0;
+};
+
+typedef std::function<bool(const AnimCanvas &, int)> FrameFn;
+
+static void canvas_init(AnimCanvas & canvas, int w, int h)
+{
+    canvas.w = w;
+    canvas.h = h;
+    canvas.rgba.assign(w * h * 4, 0);
+}
+
+static void canvas_clear(AnimCanvas & canvas, const Rect & r)
+{
+    for (int y = std::max(r.y, 0); y < std::min(r.y + r.h, canvas.h); y++)
+    {
+        for (int x = std::max(r.x, 0); x < std::min(r.x + r.w, canvas.w); x++)
+        {
+            memset(&canvas.rgba[(y * canvas.w + x) * 4], 0, 4);
+        }
+    }
+}
+
+static int read_le16(FILE * fp)
+{
+    int lo = fgetc(fp);
+    int hi = fgetc(fp);
+    return lo | (hi << 8);
+}
+
+// GIF data sub-blocks, read as a stream of LSB-first codes
+struct GifBits
+{
+    FILE *   fp;
+    uint8_t  block[256];
+    int      len  = 0;
+    int      pos  = 0;
+    uint32_t bits = 0;
+    int      num  = 0;
+    bool     end  = false;
+
+    int read_code(int size)
+    {
+        while (num < size)
+        {
+            if (pos == len)
+            {
+                int n = end ? 0 : fgetc(fp);
+                if (n <= 0 || (int)fread(block, 1, n, fp) != n)
+                {
+                    end = true;
+                    return -1;
+                }
+                len = n;
+                pos = 0;
+            }
+            bits |= block[pos++] << num;
+            num += 8;
+        }
+
+        int code = bits & ((1 << size) - 1);
+        bits >>= size;
+        num -= size;
+        return code;
+    }
+
+    // Skip whatever's left of the image data, up to its terminator
+    void finish()
+    {
+        int n;
+        while (!end && (n = fgetc(fp)) > 0)
+        {
+            fseek(fp, n, SEEK_CUR);
+        }
+        end = true;
+    }
+};
+
+static void gif_lzw(FILE * fp, int min_size, size_t pixels, std::vector<uint8_t> & out)
+{
+    static uint16_t prefix[4096];
+    static uint8_t  suffix[4096];
+    static uint8_t  stack[4097];
+
+    GifBits bits;
+    bits.fp = fp;
+
+    int     clear = 1 << min_size;
+    int     size  = min_size + 1;
+    int     next  = clear + 2;
+    int     prev  = -1;
+    uint8_t first = 0;
+
+    for (int i = 0; i < clear; i++)
+    {
+        suffix[i] = i;
+    }
+
+    out.clear();
+    while (out.size() < pixels)
+    {
+        int code = bits.read_code(size);
+        if (code < 0 || code == clear + 1)
+        {
+            break;
+        }
+
+        if (code == clear)
+        {
+            size = min_size + 1;
+            next = clear + 2;
+            prev = -1;
+            continue;
+        }
+
+        if (prev < 0)
+        {
+            if (code > clear)
+            {
+                break;        // Corrupt - must start with a literal
+            }
+            out.push_back(code);
+            prev = first = code;
+            continue;
+        }
+
+        if (code > next)
+        {
+            break;        // Corrupt
+        }
+
+        int sp = 0;
+        int c  = code;
+        if (code == next)
+        {
+            stack[sp++] = first;
+            c           = prev;
+        }
+        while (c > clear)
+        {
+            stack[sp++] = suffix[c];
+            c           = prefix[c];
+        }
+        stack[sp++] = c;
+        first       = c;
+
+        while (sp)
+        {
+            out.push_back(stack[--sp]);
+        }
+
+        if (next < 4096)
+        {
+            prefix[next] = prev;
+            suffix[next] = first;
+            if (++next == (1 << size) && size < 12)
+            {
+                size++;
+            }
+        }
+        prev = code;
+    }
+
+    bits.finish();
+    out.resize(pixels, 0);        // Short data - pad rather than fail
+}
+
+static bool read_gif(FILE * fp, const FrameFn & emit)
+{
+    int w = read_le16(fp);
+    int h = read_le16(fp);
+    int packed = fgetc(fp);
+    fgetc(fp);        // Background index - disposal clears to transparent, like browsers do
+    fgetc(fp);        // Aspect
+
+    uint8_t gct[768];
+    int     gct_size = (packed & 0x80) ? 2 << (packed & 7) : 0;
+    if ((int)fread(gct, 3, gct_size, fp) != gct_size)
+    {
+        return false;
+    }
+
+    AnimCanvas canvas;
+    canvas_init(canvas, w, h);
+
+    int  delay       = 0;
+    int  transparent = -1;
+    int  disposal    = 0;
+    int  prev_disp   = 0;
+    Rect prev_rect;
+
+    std::vector<uint8_t> indices;
+
+    for (;;)
+    {
+        int b = fgetc(fp);
+
+        if (b == 0x21)
+        {
+            int label = fgetc(fp);
+            if (label == 0xF9 && fgetc(fp) == 4)
+            {
+                int gce     = fgetc(fp);
+                delay       = read_le16(fp);
+                int tindex  = fgetc(fp);
+                transparent = (gce & 1) ? tindex : -1;
+                disposal    = (gce >> 2) & 7;
+            }
+
+            int n;
+            while ((n = fgetc(fp)) > 0)
+            {
+                fseek(fp, n, SEEK_CUR);
+            }
+        }
+        else if (b == 0x2C)
+        {
+            Rect r;
+            r.x        = read_le16(fp);
+            r.y        = read_le16(fp);
+            r.w        = read_le16(fp);
+            r.h        = read_le16(fp);
+            int ipack  = fgetc(fp);
+
+            uint8_t lct[768];
+            int     lct_size = (ipack & 0x80) ? 2 << (ipack & 7) : 0;
+            if ((int)fread(lct, 3, lct_size, fp) != lct_size)
+            {
+                return false;
+            }
+            const uint8_t * pal      = lct_size ? lct : gct;
+            int             pal_size = lct_size ? lct_size : gct_size;
+
+            // The previous frame's disposal happens just before this one is drawn
+            if (prev_disp == 2)
+            {
+                canvas_clear(canvas, prev_rect);
+            }
+            else if (prev_disp == 3 && !canvas.saved.empty())
+            {
+                canvas.rgba = canvas.saved;
+            }
+            if (disposal == 3)
+            {
+                canvas.saved = canvas.rgba;
+            }
+
+            int min_size = fgetc(fp);
+            if (min_size < 2 || min_size > 11)
+            {
+                return false;
+            }
+            gif_lzw(fp, min_size, (size_t)r.w * r.h, indices);
+
+            // Interlaced rows come in four passes
+            static const int start[4] = {0, 4, 2, 1};
+            static const int step[4]  = {8, 8, 4, 2};
+            int              pass = 0, row = 0;
+
+            for (int i = 0; i < r.h; i++)
+            {
+                int y = i;
+                if (ipack & 0x40)
+                {
+                    while (row >= r.h)
+                    {
+                        pass++;
+                        row = start[pass];
+                    }
+                    y = row;
+                    row += step[pass];
+                }
+
+                for (int x = 0; x < r.w; x++)
+                {
+                    int index = indices[i * r.w + x];
+                    int cx    = r.x + x;
+                    int cy    = r.y + y;
+
+                    if (index == transparent || index >= pal_size || cx >= w || cy >= h)
+                    {
+                        continue;
+                    }
+
+                    uint8_t * px = &canvas.rgba[(cy * w + cx) * 4];
+                    memcpy(px, &pal[index * 3], 3);
+                    px[3] = 255;
+                }
+            }
+
+            // Like browsers, treat 0 or 1 centiseconds as 100ms
+            if (!emit(canvas, delay < 2 ? 100 : delay * 10))
+            {
+                return false;
+            }
+
+            prev_disp   = disposal;
+            prev_rect   = r;
+            delay       = 0;
+            transparent = -1;
+            disposal    = 0;
+        }
+        else
+        {
+            return b == 0x3B;        // Trailer (anything else is a truncated file)
+        }
+    }
+}
+
+static uint32_t crc32_png(const uint8_t * data, size_t len, uint32_t crc = 0)
+{
+    static uint32_t table[256];
+    if (!table[1])
+    {
+        for (uint32_t n = 0; n < 256; n++)
+        {
+            uint32_t c = n;
+            for (int k = 0; k < 8; k++)
+            {
+                c = (c & 1) ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+            }
+            table[n] = c;
+        }
+    }
+
+    crc = ~crc;
+    for (size_t i = 0; i < len; i++)
+    {
+        crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+static uint32_t be32(const uint8_t * p)
+{
+    return ((uint32_t)p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+static void put_be32(std::vector<uint8_t> & out, uint32_t v)
+{
+    out.push_back(v >> 24);
+    out.push_back(v >> 16);
+    out.push_back(v >> 8);
+    out.push_back(v);
+}
+
+static void put_chunk(std::vector<uint8_t> & out, const char * type, const uint8_t * data, size_t len)
+{
+    put_be32(out, len);
+    size_t start = out.size();
+    out.insert(out.end(), type, type + 4);
+    out.insert(out.end(), data, data + len);
+    put_be32(out, crc32_png(&out[start], len + 4));
+}
+
+static bool read_apng(FILE * fp, const FrameFn & emit)
+{
+    static const uint8_t sig[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+
+    AnimCanvas           canvas;
+    std::vector<uint8_t> ihdr, pre_idat, frame_data, chunk;
+    uint8_t              fctl[26];
+    bool                 pending  = false;
+    bool                 seen_dat = false;
+    int                  frames   = 0;
+    int                  prev_disp = 0;
+    Rect                 prev_rect;
+
+    // Decode the collected frame as a standalone PNG and composite it
+    auto finish_frame = [&]() -> bool {
+        Rect r;
+        r.w            = be32(&fctl[4]);
+        r.h            = be32(&fctl[8]);
+        r.x            = be32(&fctl[12]);
+        r.y            = be32(&fctl[16]);
+        int delay_num  = (fctl[20] << 8) | fctl[21];
+        int delay_den  = (fctl[22] << 8) | fctl[23];
+        int dispose    = fctl[24];
+        int blend_over = fctl[25] == 1;
+
+        std::vector<uint8_t> png(sig, sig + 8);
+        std::vector<uint8_t> hdr = ihdr;
+        memcpy(&hdr[0], &fctl[4], 8);        // This frame's width and height
+        put_chunk(png, "IHDR", hdr.data(), hdr.size());
+        png.insert(png.end(), pre_idat.begin(), pre_idat.end());
+        put_chunk(png, "IDAT", frame_data.data(), frame_data.size());
+        put_chunk(png, "IEND", nullptr, 0);
+
+        SDL_Surface * decoded = IMG_Load_RW(SDL_RWFromConstMem(png.data(), png.size()), 1);
+        SDL_Surface * rgba    = decoded ? SDL_ConvertSurfaceFormat(decoded, SDL_PIXELFORMAT_RGBA32, 0) : nullptr;
+        if (decoded)
+        {
+            SDL_FreeSurface(decoded);
+        }
+        if (!rgba)
+        {
+            printf("*** Unable to decode APNG frame %d: %s\n", frames + 1, SDL_GetError());
+            return false;
+        }
+
+        if (prev_disp == 1)
+        {
+            canvas_clear(canvas, prev_rect);
+        }
+        else if (prev_disp == 2 && !canvas.saved.empty())
+        {
+            canvas.rgba = canvas.saved;
+        }
+        if (dispose == 2)
+        {
+            canvas.saved = canvas.rgba;
+        }
+
+        SDL_LockSurface(rgba);
+        for (int y = 0; y < std::min(r.h, canvas.h - r.y); y++)
+        {
+            const uint8_t * src = (const uint8_t *)rgba->pixels + y * rgba->pitch;
+            uint8_t *       dst = &canvas.rgba[((r.y + y) * canvas.w + r.x) * 4];
+
+            for (int x = 0; x < std::min(r.w, canvas.w - r.x); x++, src += 4, dst += 4)
+            {
+                if (!blend_over || src[3] == 255)
+                {
+                    memcpy(dst, src, 4);
+                }
+                else if (src[3])
+                {
+                    int a = src[3];
+                    for (int c = 0; c < 3; c++)
+                    {
+                        dst[c] = (src[c] * a + dst[c] * (255 - a)) / 255;
+                    }
+                    dst[3] = a + dst[3] * (255 - a) / 255;
+                }
+            }
+        }
+        SDL_UnlockSurface(rgba);
+        SDL_FreeSurface(rgba);
+
+        // First frame can't restore to previous - it's cleared instead
+        prev_disp = (frames == 0 && dispose == 2) ? 1 : dispose;
+        prev_rect = r;
+        frames++;
+        frame_data.clear();
+        pending = false;
+
+        return emit(canvas, (delay_num * 1000) / (delay_den ? delay_den : 100));
+    };
+
+    for (;;)
+    {
+        uint8_t head[8];
+        if (fread(head, 1, 8, fp) != 8)
+        {
+            return false;
+        }
+
+        uint32_t len = be32(head);
+        chunk.resize(len);
+        if (len > 0x7FFFFFFF || fread(chunk.data(), 1, len, fp) != len || fseek(fp, 4, SEEK_CUR) != 0)
+        {
+            return false;
+        }
+
+        if (!memcmp(head + 4, "IHDR", 4) && len == 13)
+        {
+            ihdr = chunk;
+            canvas_init(canvas, be32(&chunk[0]), be32(&chunk[4]));
+        }
+        else if (!memcmp(head + 4, "fcTL", 4) && len == 26)
+        {
+            if (pending && !finish_frame())
+            {
+                return false;
+            }
+            memcpy(fctl, chunk.data(), 26);
+            pending = true;
+        }
+        else if (!memcmp(head + 4, "IDAT", 4))
+        {
+            seen_dat = true;
+            if (pending)        // Otherwise the default image isn't part of the animation
+            {
+                frame_data.insert(frame_data.end(), chunk.begin(), chunk.end());
+            }
+        }
+        else if (!memcmp(head + 4, "fdAT", 4) && len >= 4)
+        {
+            frame_data.insert(frame_data.end(), chunk.begin() + 4, chunk.end());
+        }
+        else if (!memcmp(head + 4, "IEND", 4))
+        {
+            return (!pending || finish_frame()) && frames > 0;
+        }
+        else if (!seen_dat && memcmp(head + 4, "acTL", 4))
+        {
+            // PLTE, tRNS, gAMA etc - every frame needs them
+            put_chunk(pre_idat, (const char *)head + 4, chunk.data(), len);
+        }
+    }
+}
+
+/*
+ * Convert an animated GIF or APNG to numbered frames in out_dir, plus
+ * delays.txt. With -rate, frames are retimed to a fixed rate using the
+ * delays (repeating or dropping frames as needed).
+ */
+int write_anim(const char * out_dir, const char * anim_file)
+{
+    FILE * fp = fopen(anim_file, "rb");
+    if (!fp)
+    {
+        printf("*** Unable to open \"%s\"\n", anim_file);
+        return EXIT_FAILURE;
+    }
+
+    char magic[8] = {0};
+    if (fread(magic, 1, 8, fp) != 8)
+    {
+        fclose(fp);
+        printf("*** \"%s\" is too short\n", anim_file);
+        return EXIT_FAILURE;
+    }
+
+    bool gif = !memcmp(magic, "GIF87a", 6) || !memcmp(magic, "GIF89a", 6);
+    bool png = !memcmp(magic, "\x89PNG", 4);
+    if (!gif && !png)
+    {
+        fclose(fp);
+        printf("*** \"%s\" is not a GIF or PNG\n", anim_file);
+        return EXIT_FAILURE;
+    }
+    fseek(fp, gif ? 6 : 8, SEEK_SET);
+
+    int   frame_size = (out_width / 8) * out_height * (color ? 2 : 1);
+    int   written    = 0;
+    int   in_frames  = 0;
+    long  elapsed_ms = 0;
+    char  path[4096];
+
+    std::vector<uint8_t> out(frame_size);
+    SDL_Surface *        surface = nullptr;
+
+    snprintf(path, sizeof(path), "%s/delays.txt", out_dir);
+    FILE * delays = fopen(path, "w");
+    if (!delays)
+    {
+        fclose(fp);
+        printf("*** Unable to open write to output file \"%s\"\n", path);
+        return EXIT_FAILURE;
+    }
+
+    FrameFn emit = [&](const AnimCanvas & canvas, int delay_ms) -> bool {
+        if (!surface)
+        {
+            surface = SDL_CreateRGBSurfaceWithFormat(0, canvas.w, canvas.h, 32, SDL_PIXELFORMAT_RGBA32);
+            if (!surface)
+            {
+                printf("*** Unable to create surface: %s\n", SDL_GetError());
+                return false;
+            }
+        }
+
+        SDL_LockSurface(surface);
+        for (int y = 0; y < canvas.h; y++)
+        {
+            memcpy((uint8_t *)surface->pixels + y * surface->pitch, &canvas.rgba[y * canvas.w * 4], canvas.w * 4);
+        }
+        SDL_UnlockSurface(surface);
+
+        SDL_Surface * frame = fit_mode == FIT_CROP ? surface : fit_surface(surface);
+        if (!frame)
+        {
+            return false;
+        }
+
+        if (color)
+        {
+            image_to_color(frame, out.data());
+        }
+        else
+        {
+            image_to_mono(frame, out.data());
+        }
+
+        if (frame != surface)
+        {
+            SDL_FreeSurface(frame);
+        }
+
+        // Without -rate, one output frame per input frame. With it, as
+        // many output frames as there are output ticks in this frame's time.
+        long start_ms = elapsed_ms;
+        elapsed_ms += delay_ms;
+        in_frames++;
+
+        int copies = 1;
+        if (anim_rate > 0)
+        {
+            copies = (int)((elapsed_ms * anim_rate + 999) / 1000 - (start_ms * anim_rate + 999) / 1000);
+        }
+
+        for (int c = 0; c < copies; c++)
+        {
+            snprintf(path, sizeof(path), "%s/%04d.%s", out_dir, ++written, color ? "xcb" : "xmb");
+            if (!write_file(path, out.data(), out.size()))
+            {
+                return false;
+            }
+            fprintf(delays, "%04d %d\n", written, anim_rate > 0 ? 1000 / anim_rate : delay_ms);
+        }
+
+        return true;
+    };
+
+    printf("Decoding %s \"%s\"...\n", gif ? "GIF" : "APNG", anim_file);
+    bool good = gif ? read_gif(fp, emit) : read_apng(fp, emit);
+
+    fclose(fp);
+    fclose(delays);
+    if (surface)
+    {
+        SDL_FreeSurface(surface);
+    }
+
+    printf("%d input frames (%ld ms) -> %d output frames in \"%s\"\n", in_frames, elapsed_ms, written, out_dir);
+    printf(good ? "Success.\n" : "*** Failed (truncated or unsupported file?)\n");
+
+    return good ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/*
+ * Stage benchmark (-bench-suite, see "make bench")
+ *
+ * For each image, times each stage of a plain mono conversion on its
+ * own - decode, pixel fetch (getpixel + SDL_GetRGB, into a brightness
+ * buffer), threshold/pack (from that buffer) and write - and the whole
+ * thing end to end, at the image's own size.
+ * Every stage gets BENCH_WARMUP untimed runs and then reps timed ones,
+ * and the median and p95 are appended to the CSV as one row per stage,
+ * labelled with $BENCH_LABEL (e.g. a commit) so runs can be compared.
+ */
+static const int BENCH_WARMUP = 2;
+
+// Threshold and pack width x height brightness values (width a multiple of 8), as image_to_mono does
+static void pack_luma(const uint8_t * luma, int width, int height, uint8_t * out_pixels)
+{
+    for (int i = 0; i < width * height; i += 8)
+    {
+        uint8_t val = 0;
+        for (int b = 0; b < 8; b++)
+        {
+            if (mono_pixel(luma[i + b]))
+            {
+                val |= (0x80 >> b);
+            }
+        }
+        *out_pixels++ = val;
+    }
+}
+
+struct BenchStats
+{
+    double median_ms;
+    double p95_ms;
+};
+
+static BenchStats time_stage(int reps, const std::function<void()> & fn)
+{
+    std::vector<double> ms;
+
+    for (int r = 0; r < BENCH_WARMUP + reps; r++)
+    {
+        auto start = bench_clock::now();
+        fn();
+        if (r >= BENCH_WARMUP)
+        {
+            ms.push_back(seconds_since(start) * 1000);
+        }
+    }
+
+    // Nearest rank
+    std::sort(ms.begin(), ms.end());
+    BenchStats stats;
+    stats.median_ms = ms[(ms.size() - 1) / 2];
+    stats.p95_ms    = ms[std::min(ms.size() - 1, (size_t)ceil(ms.size() * 0.95) - 1)];
+    return stats;
+}
+
+int run_bench_suite(const char * csv_file, int reps)
+{
+    const char * label = getenv("BENCH_LABEL");
+    FILE *       probe = fopen(csv_file, "r");
+    bool         fresh = !probe;
+    if (probe)
+    {
+        fclose(probe);
+    }
+
+    FILE * csv = fopen(csv_file, "a");
+    if (!csv)
+    {
+        printf("*** Unable to open write to output file \"%s\"\n", csv_file);
+        return EXIT_FAILURE;
+    }
+    if (fresh)
+    {
+        fprintf(csv, "label,image,width,height,stage,reps,median_ms,p95_ms,mpix_per_s\n");
+    }
+
+    std::string out_path = std::string(csv_file) + ".xmb";
+
+    printf("%-32s %9s %-8s %10s %10s %10s\n", "image", "size", "stage", "median ms", "p95 ms", "Mpix/s");
+
+    for (char * file : frame_files)
+    {
+        SDL_Surface * image = IMG_Load(file);
+        if (!image)
+        {
+            printf("*** Unable to load \"%s\"\n", file);
+            fclose(csv);
+            return EXIT_FAILURE;
+        }
+
+        // Convert at the image's own size, so wide images cost what they should
+        int save_w = out_width, save_h = out_height;
+        out_width  = image->w & ~7;
+        out_height = image->h;
+
+        size_t               out_size = (size_t)(out_width / 8) * out_height;
+        std::vector<uint8_t> out(out_size);
+        std::vector<uint8_t> luma((size_t)out_width * out_height);
+        double               mpix = (double)out_width * out_height / 1e6;
+
+        std::vector<std::pair<const char *, BenchStats>> stages;
+
+        stages.emplace_back("decode", time_stage(reps, [&]() { SDL_FreeSurface(IMG_Load(file)); }));
+        stages.emplace_back("fetch", time_stage(reps, [&]() {
+                                SDL_LockSurface(image);
+                                uint8_t * p = luma.data();
+                                for (int y = 0; y < out_height; y++)
+                                {
+                                    for (int x = 0; x < out_width; x++)
+                                    {
+                                        SDL_Color rgb;
+                                        SDL_GetRGB(getpixel(image, x, y), image->format, &rgb.r, &rgb.g, &rgb.b);
+                                        *p++ = (rgb.r + rgb.g + rgb.b) / 3;
+                                    }
+                                }
+                                SDL_UnlockSurface(image);
+                            }));
+        stages.emplace_back("pack", time_stage(reps, [&]() { pack_luma(luma.data(), out_width, out_height, out.data()); }));
+        stages.emplace_back("write", time_stage(reps, [&]() { write_file(out_path.c_str(), out.data(), out_size); }));
+        stages.emplace_back("total", time_stage(reps, [&]() {
+                                SDL_Surface * frame = load_image(file);
+                                if (frame)
+                                {
+                                    image_to_mono(frame, out.data());
+                                    write_file(out_path.c_str(), out.data(), out_size);
+                                    SDL_FreeSurface(frame);
+                                }
+                            }));
+
+        const char * name = strrchr(file, '/') ? strrchr(file, '/') + 1 : file;
+        for (auto & stage : stages)
+        {
+            double rate = stage.second.median_ms > 0 ? mpix / (stage.second.median_ms / 1000) : 0;
+            printf("%-32s %4dx%-4d %-8s %10.3f %10.3f %10.1f\n",
+                   name,
+                   out_width,
+                   out_height,
+                   stage.first,
+                   stage.second.median_ms,
+                   stage.second.p95_ms,
+                   rate);
+            fprintf(csv,
+                    "%s,%s,%d,%d,%s,%d,%.4f,%.4f,%.2f\n",
+                    label ? label : "",
+                    file,
+                    out_width,
+                    out_height,
+                    stage.first,
+                    reps,
+                    stage.second.median_ms,
+                    stage.second.p95_ms,
+                    rate);
+        }
+
+        SDL_FreeSurface(image);
+        out_width  = save_w;
+        out_height = save_h;
+    }
+
+    fclose(csv);
+    remove(out_path.c_str());
+    printf("Results appended to \"%s\"\n", csv_file);
+
+    return EXIT_SUCCESS;
+}
+
+/*
+ * A synthetic test image: hard edges (boxes and a checkerboard), smooth
+ * gradients and noise, so thresholding sees every kind of content.
+ */
+int write_synthetic(const char * geom, const char * out_png)
+{
+    int w = 0, h = 0;
+    if (sscanf(geom, "%dx%d", &w, &h) != 2 || w <= 0 || h <= 0)
+    {
+        printf("*** Bad -synth size: %s (WxH)\n", geom);
+        return EXIT_FAILURE;
+    }
+
+    SDL_Surface * image = SDL_CreateRGBSurfaceWithFormat(0, w, h, 24, SDL_PIXELFORMAT_RGB24);
+    if (!image)
+    {
+        printf("*** Unable to create surface: %s\n", SDL_GetError());
+        return EXIT_FAILURE;
+    }
+
+    uint32_t seed = 0x2545F491;
+    SDL_LockSurface(image);
+    for (int y = 0; y < h; y++)
+    {
+        uint8_t * p = (uint8_t *)image->pixels + y * image->pitch;
+        for (int x = 0; x < w; x++, p += 3)
+        {
+            seed ^= seed << 13;
+            seed ^= seed >> 17;
+            seed ^= seed << 5;
+
+            int band = x * 4 / w;
+            int v;
+            switch (band)
+            {
+                case 0:
+                    v = ((x / 8 + y / 8) & 1) ? 255 : 0;
+                    break;
+                case 1:
+                    v = (x * 255 * 4 / w + y) & 255;
+                    break;
+                case 2:
+                    v = seed & 255;
+                    break;
+                default:
+                    v = ((x % 37) < 18) ^ ((y % 23) < 11) ? 224 : 32;
+                    break;
+            }
+
+            p[0] = v;
+            p[1] = (v + (seed >> 8)) & 255;
+            p[2] = 255 - v;
+        }
+    }
+    SDL_UnlockSurface(image);
+
+    bool good = IMG_SavePNG(image, out_png) == 0;
+    SDL_FreeSurface(image);
+
+    printf(good ? "Wrote %s (%d x %d)\n" : "*** Unable to write %s (%d x %d)\n", out_png, w, h);
+    return good ? EXIT_SUCCESS : EXIT_FAILURE;
 }
 
 Uint32 getpixel(SDL_Surface * surface, int x, int y)
@@ -0,0 +1,226 @@
+/*
+ * vim: set et ts=4 sw=4
+ *------------------------------------------------------------
+ *                                  ___ ___ _
+ *  ___ ___ ___ ___ ___       _____|  _| . | |_
+ * |  _| . |_ -|  _| . |     |     | . | . | '_|
+ * |_| |___|___|___|___|_____|_|_|_|___|___|_,_|
+ *                     |_____|
+ * ------------------------------------------------------------
+ * Copyright (c) 2021 Ross Bamford
+ * MIT License
+ *
+ * Host test for raster_fx.c - checks the copper program it
+ * generates (band WAITs, MOVER registers and values, and the
+ * instruction count), and what rfx_animate() patches.
+ *
+ *   make raster_test
+ * ------------------------------------------------------------
+ */
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "../raster_fx.h"
+
+#define PI          3.14159265358979323846
+
+#define MOVER_REG(instr)    (((instr) >> 16) & 0xFF)
+#define MOVER_VAL(instr)    ((instr) & 0xFFFF)
+
+static int failures = 0;
+
+#define CHECK(cond, ...)                                \
+    do {                                                \
+        if (!(cond)) {                                  \
+            printf("FAIL %s:%d: ", __FILE__, __LINE__); \
+            printf(__VA_ARGS__);                        \
+            printf("\n");                               \
+            failures++;                                 \
+        }                                               \
+    } while (0)
+
+// Stand-ins for copper.c's (which also has the code that talks to Xosera)
+void cop_reset(CopProg *prog) {
+    prog->len = 0;
+    prog->num_relocs = 0;
+    prog->overflow = false;
+}
+
+uint16_t cop_append(CopProg *prog, uint32_t instr) {
+    if (prog->len >= COP_MAX_INSTRS) {
+        prog->overflow = true;
+        return COP_MAX_INSTRS - 1;
+    }
+
+    prog->code[prog->len] = instr;
+    return prog->len++;
+}
+
+// What a band's register should be set to, worked out independently of raster_fx.c
+static uint16_t expect_value(const RfxDesc *desc, uint8_t target, int band, int frame) {
+    int sum = 0;
+
+    for (int w = 0; w < desc->num_waves; w++) {
+        const RfxWave *wave = &desc->waves[w];
+
+        if (wave->target == target) {
+            int idx = (band * wave->frequency + frame * wave->speed) & 0xFF;
+            sum += wave->offset + (rfx_sine[idx] * wave->amplitude) / 127;
+        }
+    }
+
+    if (target == RFX_PA_LINE) {
+        int line = band * desc->band_height / desc->line_div + sum;
+        return (uint16_t)(desc->line_base + line * desc->line_len);
+    }
+
+    sum = sum < 0 ? 0 : sum > RFX_MAX_HSCROLL ? RFX_MAX_HSCROLL : sum;
+    return MAKE_HV_SCROLL(sum, 0);
+}
+
+static void check_sine() {
+    for (int i = 0; i < 256; i++) {
+        int want = (int)lround(127.0 * sin(2.0 * PI * i / 256.0));
+        CHECK(rfx_sine[i] == want, "rfx_sine[%d] is %d, want %d", i, rfx_sine[i], want);
+    }
+}
+
+// Whole program for desc (after a lead-in instruction), then a few frames of animation
+static void check_program(const char *name, const RfxDesc *desc, const uint8_t *regs, int num_regs) {
+    static CopProg prog;
+    RfxState fx;
+    const uint8_t targets[3] = { RFX_PA_HSCROLL, RFX_PA_LINE, RFX_PB_HSCROLL };
+    const uint8_t target_regs[3] = { XR_PA_HV_SCROLL, XR_PA_LINE_ADDR, XR_PB_HV_SCROLL };
+
+    printf("%s\n", name);
+
+    cop_reset(&prog);
+    cop_wait_v(&prog, 0);
+
+    CHECK(rfx_build(&fx, desc, &prog), "rfx_build failed");
+
+    int bands = (desc->bottom - desc->top + desc->band_height - 1) / desc->band_height;
+    int resets = 0;
+    for (int r = 0; r < num_regs; r++) {
+        resets += regs[r] != XR_PA_LINE_ADDR;
+    }
+
+    CHECK(fx.first == 1, "first band at %d, want 1", fx.first);
+    CHECK(fx.bands == bands, "%d bands, want %d", fx.bands, bands);
+    CHECK(fx.per_band == 1 + num_regs, "%d instructions per band, want %d", fx.per_band, 1 + num_regs);
+    CHECK(prog.len == 1 + bands * (1 + num_regs) + 1 + resets,
+            "%d instructions, want %d", prog.len, 1 + bands * (1 + num_regs) + 1 + resets);
+
+    for (int frame = 0; frame < 4; frame++) {
+        int changed = 0;
+
+        // Count what should change before animating (values are still last frame's)
+        if (frame) {
+            for (int b = 0; b < bands; b++) {
+                int idx = 1 + b * (1 + num_regs) + 1;
+
+                for (int t = 0; t < 3; t++) {
+                    if (fx.targets & targets[t]) {
+                        changed += MOVER_VAL(prog.code[idx++]) != expect_value(desc, targets[t], b, frame);
+                    }
+                }
+            }
+
+            uint16_t patched = rfx_animate(&fx, &prog);
+            CHECK(patched == changed, "frame %d patched %d values, want %d", frame, patched, changed);
+        }
+
+        for (int b = 0; b < bands; b++) {
+            int idx = 1 + b * (1 + num_regs);
+            uint32_t wait = COP_WAIT_V(desc->top + b * desc->band_height);
+
+            CHECK(prog.code[idx] == wait, "band %d WAIT is 0x%08x, want 0x%08x", b,
+                    (unsigned)prog.code[idx], (unsigned)wait);
+            idx++;
+
+            // MOVERs in RFX_* order, which is also regs[] order
+            int r = 0;
+            for (int t = 0; t < 3; t++) {
+                if (!(fx.targets & targets[t])) {
+                    continue;
+                }
+
+                uint32_t instr = prog.code[idx++];
+                uint16_t want = expect_value(desc, targets[t], b, frame);
+
+                CHECK(r < num_regs && target_regs[t] == regs[r], "band %d: unexpected target %d", b, t);
+                CHECK((instr & 0xFF000000) == 0x60000000, "band %d: 0x%08x isn't a MOVER", b, (unsigned)instr);
+                CHECK(MOVER_REG(instr) == target_regs[t], "band %d: MOVER to 0x%02x, want 0x%02x", b,
+                        (unsigned)MOVER_REG(instr), target_regs[t]);
+                CHECK(MOVER_VAL(instr) == want, "band %d frame %d: value 0x%04x, want 0x%04x", b, frame,
+                        (unsigned)MOVER_VAL(instr), want);
+                r++;
+            }
+        }
+    }
+
+    // Scroll registers go back to 0 at the bottom
+    int idx = 1 + bands * (1 + num_regs);
+    CHECK(prog.code[idx] == COP_WAIT_V(desc->bottom), "no WAIT for the bottom");
+    for (int r = 0; r < resets; r++) {
+        uint32_t instr = prog.code[idx + 1 + r];
+        CHECK((instr & 0xFF000000) == 0x60000000 && MOVER_REG(instr) != XR_PA_LINE_ADDR && MOVER_VAL(instr) == 0,
+                "reset %d is 0x%08x", r, (unsigned)instr);
+    }
+}
+
+static void check_bad_descs() {
+    static CopProg prog;
+    RfxState fx;
+    const RfxWave wave = { RFX_PA_HSCROLL, 8, 4, 1, 8 };
+
+    printf("bad descriptions\n");
+
+    const RfxDesc no_height = { 72, 408, 0, 2, 0, 0, 1, &wave };
+    cop_reset(&prog);
+    CHECK(!rfx_build(&fx, &no_height, &prog), "band_height 0 accepted");
+
+    const RfxDesc upside_down = { 408, 72, 8, 2, 0, 0, 1, &wave };
+    cop_reset(&prog);
+    CHECK(!rfx_build(&fx, &upside_down, &prog), "bottom above top accepted");
+
+    // Every scanline, two registers each, can't fit a raster half
+    const RfxDesc too_big = { 0, 480, 1, 2, 0, 0, 1, &wave };
+    cop_reset(&prog);
+    CHECK(!rfx_build(&fx, &too_big, &prog), "overflowing program accepted");
+}
+
+int main() {
+    // As the demo's RASTER_FX
+    const RfxWave demo_waves[] = {
+        { RFX_PA_HSCROLL, 12, 6, 3, 12 },
+        { RFX_PB_HSCROLL, 6, 10, 5, 6 },
+    };
+    const RfxDesc demo = { 72, 408, 8, 2, 0, 0, 2, demo_waves };
+    const uint8_t demo_regs[] = { XR_PA_HV_SCROLL, XR_PB_HV_SCROLL };
+
+    // Line offsets (with two waves summed), clamped scroll, and a partial last band
+    const RfxWave mixed_waves[] = {
+        { RFX_PA_LINE, 4, 16, 2, 0 },
+        { RFX_PA_LINE, 2, 40, 7, 1 },
+        { RFX_PA_HSCROLL, 40, 8, 4, 0 },
+    };
+    const RfxDesc mixed = { 100, 205, 6, 2, 0x1000, 160, 3, mixed_waves };
+    const uint8_t mixed_regs[] = { XR_PA_HV_SCROLL, XR_PA_LINE_ADDR };
+
+    check_sine();
+    check_program("demo wobble", &demo, demo_regs, 2);
+    check_program("line offsets", &mixed, mixed_regs, 2);
+    check_bad_descs();
+
+    if (failures) {
+        printf("%d failures\n", failures);
+        return 1;
+    }
+
+    printf("All OK\n");
+    return 0;
+}
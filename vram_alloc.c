@@ -0,0 +1,181 @@
+/*
+ * vim: set et ts=4 sw=4
+ *------------------------------------------------------------
+ *                                  ___ ___ _
+ *  ___ ___ ___ ___ ___       _____|  _| . | |_
+ * |  _| . |_ -|  _| . |     |     | . | . | '_|
+ * |_| |___|___|___|___|_____|_|_|_|___|___|_,_|
+ *                     |_____|
+ * ------------------------------------------------------------
+ * Copyright (c) 2021 Ross Bamford
+ * MIT License
+ *
+ * VRAM region allocator
+ * ------------------------------------------------------------
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "vram_alloc.h"
+#include "dprint.h"
+
+static VramRegion regions[VRAM_MAX_REGIONS];
+static uint8_t num_regions = 0;
+
+static const VramRegion* find_conflict(uint32_t addr, uint32_t words, uint8_t phases, const VramRegion *skip) {
+    for (int i = 0; i < num_regions; i++) {
+        const VramRegion *r = &regions[i];
+
+        if (r != skip && (r->phases & phases) && addr < r->addr + r->words && r->addr < addr + words) {
+            return r;
+        }
+    }
+
+    return NULL;
+}
+
+static bool add_region(const char *name, uint16_t addr, uint32_t words, uint8_t phases) {
+    if (num_regions == VRAM_MAX_REGIONS) {
+        dprintf("VRAM: Too many regions (adding '%s')\n", name);
+        return false;
+    }
+
+    regions[num_regions].name = name;
+    regions[num_regions].addr = addr;
+    regions[num_regions].words = words;
+    regions[num_regions].phases = phases;
+    num_regions++;
+
+    return true;
+}
+
+void vram_reset() {
+    num_regions = 0;
+}
+
+bool vram_alloc(const char *name, uint32_t words, uint16_t align, uint8_t phases, uint16_t *addr) {
+    uint32_t mask = align ? align - 1 : 0;
+    uint32_t best = VRAM_WORDS;
+
+    // Lowest fit is either at zero or just after some region in the same phase
+    for (int i = -1; i < num_regions; i++) {
+        uint32_t candidate = 0;
+
+        if (i >= 0) {
+            if (!(regions[i].phases & phases)) {
+                continue;
+            }
+            candidate = regions[i].addr + regions[i].words;
+        }
+
+        candidate = (candidate + mask) & ~mask;
+
+        if (candidate < best && candidate + words <= VRAM_WORDS
+                && !find_conflict(candidate, words, phases, NULL)) {
+            best = candidate;
+        }
+    }
+
+    if (best == VRAM_WORDS) {
+        dprintf("VRAM: No room for '%s' (%lu words, largest free %lu)\n",
+                name, words, vram_largest_free(phases));
+        return false;
+    }
+
+    if (!add_region(name, best, words, phases)) {
+        return false;
+    }
+
+    *addr = best;
+    return true;
+}
+
+bool vram_place(const char *name, uint16_t addr, uint32_t words, uint8_t phases) {
+    const VramRegion *r;
+
+    if ((uint32_t)addr + words > VRAM_WORDS) {
+        dprintf("VRAM: '%s' runs off the end of VRAM\n", name);
+        return false;
+    }
+
+    if ((r = find_conflict(addr, words, phases, NULL))) {
+        dprintf("VRAM: '%s' overlaps '%s'\n", name, r->name);
+        return false;
+    }
+
+    return add_region(name, addr, words, phases);
+}
+
+bool vram_verify() {
+    bool ok = true;
+
+    for (int i = 0; i < num_regions; i++) {
+        const VramRegion *a = &regions[i];
+        const VramRegion *b = find_conflict(a->addr, a->words, a->phases, a);
+
+        if (b) {
+            dprintf("VRAM: '%s' overlaps '%s'\n", a->name, b->name);
+            ok = false;
+        }
+    }
+
+    return ok;
+}
+
+uint32_t vram_free_words(uint8_t phase) {
+    uint32_t used = 0;
+
+    for (int i = 0; i < num_regions; i++) {
+        if (regions[i].phases & phase) {
+            used += regions[i].words;
+        }
+    }
+
+    return VRAM_WORDS - used;
+}
+
+uint32_t vram_largest_free(uint8_t phase) {
+    uint32_t largest = 0;
+
+    // Every gap starts at zero or at the end of a region
+    for (int i = -1; i < num_regions; i++) {
+        uint32_t start = 0;
+        uint32_t end = VRAM_WORDS;
+
+        if (i >= 0) {
+            if (!(regions[i].phases & phase)) {
+                continue;
+            }
+            start = regions[i].addr + regions[i].words;
+        }
+
+        if (find_conflict(start, 1, phase, NULL)) {
+            continue;
+        }
+
+        for (int j = 0; j < num_regions; j++) {
+            if ((regions[j].phases & phase) && regions[j].addr >= start && regions[j].addr < end) {
+                end = regions[j].addr;
+            }
+        }
+
+        if (end - start > largest) {
+            largest = end - start;
+        }
+    }
+
+    return largest;
+}
+
+void vram_report() {
+    for (int i = 0; i < num_regions; i++) {
+        dprintf("VRAM: 0x%04x-0x%04lx %-12s phases 0x%02x\n", regions[i].addr,
+                regions[i].addr + regions[i].words - 1, regions[i].name, regions[i].phases);
+    }
+
+    dprintf("VRAM: %lu words free while loading, %lu during playback (largest block %lu)\n",
+            vram_free_words(VRAM_PHASE_LOADING), vram_free_words(VRAM_PHASE_PLAYBACK),
+            vram_largest_free(VRAM_PHASE_PLAYBACK));
+}
@@ -0,0 +1,61 @@
+/*
+ * vim: set et ts=4 sw=4
+ *------------------------------------------------------------
+ *                                  ___ ___ _
+ *  ___ ___ ___ ___ ___       _____|  _| . | |_
+ * |  _| . |_ -|  _| . |     |     | . | . | '_|
+ * |_| |___|___|___|___|_____|_|_|_|___|___|_,_|
+ *                     |_____|
+ * ------------------------------------------------------------
+ * Copyright (c) 2021 Ross Bamford
+ * MIT License
+ *
+ * VRAM region allocator
+ *
+ * Hands out named regions of VRAM with a given alignment and
+ * set of lifetime phases. Regions only have to stay clear of
+ * other regions that are live in at least one of the same
+ * phases, so e.g. the loading screen buffers can share VRAM
+ * with the playback buffers. Allocation is first fit from the
+ * bottom of VRAM, which keeps things packed.
+ * ------------------------------------------------------------
+ */
+
+#if !defined(VRAM_ALLOC_H)
+#define VRAM_ALLOC_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define VRAM_WORDS          0x10000
+#define VRAM_MAX_REGIONS    16
+
+// Lifetime phases (a region can be live in several)
+#define VRAM_PHASE_LOADING  0x01
+#define VRAM_PHASE_PLAYBACK 0x02
+#define VRAM_PHASE_ALL      0xFF
+
+typedef struct {
+    const char  *name;
+    uint16_t    addr;
+    uint32_t    words;
+    uint8_t     phases;
+} VramRegion;
+
+void vram_reset();
+
+// Allocate words at align (power of two, in words). Returns false if it won't fit.
+bool vram_alloc(const char *name, uint32_t words, uint16_t align, uint8_t phases, uint16_t *addr);
+
+// Claim a fixed region (e.g. one that the hardware insists on). Returns false on overlap.
+bool vram_place(const char *name, uint16_t addr, uint32_t words, uint8_t phases);
+
+// Check no two regions sharing a phase overlap
+bool vram_verify();
+
+uint32_t vram_free_words(uint8_t phase);
+uint32_t vram_largest_free(uint8_t phase);
+
+void vram_report();
+
+#endif
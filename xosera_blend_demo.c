@@ -33,22 +33,61 @@
 #include "xosera_primitives.h"
 #include "dprint.h"
 #include "pcx.h"
+#include "copper.h"
+#include "copper_palette.h"
+#include "raster_fx.h"
+#include "scroll_canvas.h"
+#include "frame_sched.h"
+#include "xr_queue.h"
+#include "vram_alloc.h"
+#include "pb_present.h"
+#include "prof.h"
+#include "hud.h"
+#include "xosera_blit.h"
+#include "bob.h"
+#include "ram_arena.h"
+#include "pa_fx.h"
+#ifdef EMBEDDED_FRAMES
+#include "embedded_frames.h"
+#endif
 
 #define GFX_MODE_8BPPX2         0x0065
 #define GFX_MODE_8BPPX2_BLANK   0x00E5
 #define GFX_MODE_1BPPX2         0x0045
+#define GFX_MODE_1BPPX2_TILE    0x0005
 
 /*
  * Options - Change these to suit your tastes
  */
 
 // Directory on SD card containing frames with filenames like "0001.xmb".
-// The files must be consecutive, and start at 1. A maximum of MAX_FRAMES
-// will be loaded.
+// The files must be consecutive, and start at 1. As many as fit in RAM
+// will be loaded (a few dozen on-board, hundreds with expansion RAM).
 //
 // WARNING: Max 9 characters!
 #define FRAME_DIR   "xotext"
 
+// Define to play tile-deduplicated frames ("0001.xtm" tilemaps plus
+// "glyphs.xtg", from the converter's -t mode) in tile mode, rather
+// than bitmaps. Only the tilemap entries that changed are written.
+//#define TILE_PLAYBACK
+
+// Define to play colour frames ("0001.xcb" plus "palette.xpl", from the
+// converter's -color mode), with a foreground/background attribute for
+// every 8 pixels. ATTR and the attribute effects don't apply.
+//#define COLOR_FRAMES
+
+#if defined TILE_PLAYBACK && defined COLOR_FRAMES
+#error TILE_PLAYBACK and COLOR_FRAMES are different frame formats, pick one
+#endif
+
+// EMBEDDED_FRAMES plays frames linked into the binary rather than from SD.
+// Don't define it here - build with e.g. `make EMBED=path/to/frames.c`,
+// where frames.c comes from the converter's -c mode (mono or -color).
+#if defined EMBEDDED_FRAMES && defined TILE_PLAYBACK
+#error EMBEDDED_FRAMES only supports bitmap frames, not TILE_PLAYBACK
+#endif
+
 // Sets the (starting, if effects are used) attribute to draw the animations
 // in 1bpp modes. High nybble is foreground, low is background
 #define ATTR        0x0F
@@ -57,51 +96,221 @@
 //#define SLOW_CYCLE                // Define to slowly cycle normal/inverse
 //#define PSYCHEDELIC               // Define to quickly cycle colours
 
+// Animation speed - a new frame is presented every FRAME_VBLANKS vblanks
+#define FRAME_VBLANKS   3
+
+// Define to wobble the playfields with copper raster effects
+//#define RASTER_FX
+
+// Define to continuously scroll PA (as a ring buffer) rather than clearing it
+//#define SCROLL_CANVAS
+
+#if defined RASTER_FX && defined SCROLL_CANVAS
+#error RASTER_FX and SCROLL_CANVAS both need the PA copper bands, pick one
+#endif
+
+// Define to bounce software sprites (BOBs) around PA over a fixed
+// background, instead of drawing random lines
+//#define BOBS
+#define DEMO_BOBS   8
+
+// Define to print how many BOBs can move per frame at startup
+//#define BOB_BENCH
+
+#if defined BOBS && defined SCROLL_CANVAS
+#error BOBS draw on a plain canvas, so cannot be used with SCROLL_CANVAS
+#endif
+
+// Define to fill PA with a procedural effect (PAFX_PLASMA, PAFX_FIRE,
+// PAFX_STARFIELD or PAFX_TUNNEL) instead of drawing random lines
+//#define PA_EFFECT   PAFX_PLASMA
+#define PA_FX_ROWS          8       // Rows drawn per idle slice
+#define PA_FX_FRAME_ROWS    42      // Rows per frame (a full pass every four frames)
+
+// Define to print the pixels per frame each PA effect sustains at startup
+//#define PA_FX_BENCH
+
+#if defined PA_EFFECT && (defined BOBS || defined SCROLL_CANVAS)
+#error PA_EFFECT owns the whole canvas, so cannot be used with BOBS or SCROLL_CANVAS
+#endif
+
+// Define to time the main loop phases. Summary is printed on keypress,
+// or every PROF_REPORT_LOOPS times through the animation
+#define PROFILE
+#define PROF_REPORT_LOOPS   16
+
+// Define to also show each profiled phase as a border colour, so the
+// border becomes a bar chart of CPU time against the beam (needs PROFILE)
+//#define RASTER_BARS
+
+#if defined RASTER_BARS && !defined PROFILE
+#error RASTER_BARS needs PROFILE
+#endif
+
+// Define to show frame rate, frame time, dropped frames and Xosera writes
+// per frame in a text band (tile mode) under the animation
+//#define PERF_HUD
+
+// Define to print a bytes/ms table for the VRAM transfer kernels at startup
+//#define BLIT_BENCH
+
 /*
  * Probably leave the rest of the defines alone unless you know what you're doing...
  */
 #define FRAME_SIZE  9600
-#define MAX_FRAMES  32
 
-/* Playfield A and B buffers for 8bpp mode - no backbuffers (no space) */
-#define PA_8BPP     0
-#define PB_8BPP     0x9600
+/* RAM for the loading screen image, and short-lived work space (the glyph set, or the blit bench) */
+#define LOAD_BUF_SIZE   32768
+#ifdef BLIT_BENCH
+#define SCRATCH_SIZE    16384
+#else
+#define SCRATCH_SIZE    2048
+#endif
+
+/* Tile playback: one glyph index byte per 8x8 cell, glyphs at the bottom of tile memory */
+#define TILEMAP_SIZE        1200        // 40x30 cells
+#define TILE_GLYPH_BASE     0x0000
+#define TILE_MAX_GLYPHS     256
+
+#ifdef TILE_PLAYBACK
+#define FRAME_BYTES TILEMAP_SIZE
+#define FRAME_EXT   "xtm"
+#elif defined COLOR_FRAMES
+#define FRAME_BYTES (FRAME_SIZE * 2)   // Attribute + 8 pixels per word
+#define FRAME_EXT   "xcb"
+#else
+#define FRAME_BYTES FRAME_SIZE
+#define FRAME_EXT   "xmb"
+#endif
+
+/* Playfield A and B buffers for 8bpp loading screen - no backbuffers (no space) */
+#define LOAD_PA_LEN 38400           // 320x240
+#define LOAD_PB_LEN 27136           // The rest of VRAM
+
+/* Triple buffers for PB in 1bpp mode, one word (attribute + 8 pixels, or glyph) per 8 pixels / cell */
+#ifdef TILE_PLAYBACK
+#define PB_BUF_LEN  TILEMAP_SIZE
+#else
+#define PB_BUF_LEN  FRAME_SIZE
+#endif
+#define PB_NUM_BUFS 3
+
+/* random_pa_line and the PA effects only ever use colours 0-127, so only those are animated */
+#define PA_PAL_COLORS   128
 
-/* Double buffers for PB in 1bpp mode */
-#define PB_BUF_0    0
-#define PB_BUF_1    0x4b00
+/* PA blend bits, toggled every 256 animation cycles */
+#define PA_BLEND_ALT    0x8000
 
-/* Single buffer for PA in 8bpp mode, 320x168 lines due to VRAM limits */
-#define PA_BUF      0x9600
+/* PA drawing done in idle time between frames */
+#define PA_LINES_PER_FRAME  2
+#define PA_CLEAR_ROWS       8       // Rows cleared per idle slice
+
+/* HUD text row, in native scanlines (must be a multiple of 16) */
+#define HUD_TOP             416
+#define HUD_MAX_WRITES      12      // Words per frame spent updating it
+
+/* Once playing, log output is buffered and sent in idle time (~1ms per char at 9600 baud) */
+#define LOG_DRAIN_CHARS     4
+#define LOG_DRAIN_TICKS     (LOG_DRAIN_CHARS * 11)
+
+/* Single buffer for PA in 8bpp mode, 320x168 lines (the part the copper shows) */
+#define PA_ROWS     168
+#ifdef SCROLL_CANVAS
+/* Plus a spare row for the ring: 320 * 169 == 54080 bytes == 27040 / 0x6990 words */
+#define PA_LEN      SC_VRAM_WORDS(PA_ROWS, 160)
+#else
 /* 320 * 168 == 53760 bytes == 26880 / 0x6900 words */
 #define PA_LEN      0x6900
+#endif
+
+/* Border colours for RASTER_BARS, in the top of the palette PA lines don't use */
+#define BAR_COLOR_BASE  0xF8
+#define BAR_DRAW        (BAR_COLOR_BASE + 0)
+#define BAR_LINE        (BAR_COLOR_BASE + 1)
+#define BAR_PALETTE     (BAR_COLOR_BASE + 2)
+#define BAR_FLIP        (BAR_COLOR_BASE + 3)
+
+#ifdef PROFILE
+#define PROF_BEGIN(id)  prof_begin(id)
+#define PROF_END(id)    prof_end(id)
+#else
+#define PROF_BEGIN(id)
+#define PROF_END(id)
+#endif
 
 extern void install_intr();
 extern void remove_intr();
 
-extern void* _end;
+/* raster copper program (built at runtime, double-buffered in copper memory) */
+static CopProg raster_prog;
 
-/* copper list */
-uint16_t copper_list_size = 5;
-const uint32_t copper_list[] = {
-    COP_WAIT_V(72),                                     // wait  0, 72                   ; Wait for line 40, H position ignored
-    COP_MOVER(GFX_MODE_8BPPX2, PA_GFX_CTRL),            // mover 0x0065, PA_GFX_CTRL     ; Set to 8-bpp + Hx2 + Vx2
-    COP_WAIT_V(408),                                    // wait  0, 408                  ; Wait for line 440, H position ignored
-    COP_MOVER(GFX_MODE_8BPPX2_BLANK, PA_GFX_CTRL),      // mover 0x00E5, PA_GFX_CTRL     ; Set to Blank + 8-bpp + Hx2 + Vx2
-    COP_END()                                           // nextf
+#ifdef RASTER_FX
+/* Wobble both playfields between the PA display splits, in 8-line bands */
+static const RfxWave raster_fx_waves[] = {
+    { RFX_PA_HSCROLL, 12, 6, 3, 12 },
+    { RFX_PB_HSCROLL, 6, 10, 5, 6 },
 };
+static const RfxDesc raster_fx_desc = { 72, 408, 8, 2, 0, 0, 2, raster_fx_waves };
+static RfxState raster_fx;
+#endif
+
+#ifdef SCROLL_CANVAS
+static ScrollCanvas pa_canvas;
+#endif
+
+/* Copper palette sequences, one per palette_component */
+static PalSeq pa_pal_seqs[3];
+static uint16_t pa_pal_target[PA_PAL_COLORS];
+
+/* VRAM layout, set up by layout_vram() */
+static uint16_t pa_8bpp;
+static uint16_t pb_8bpp;
+static uint16_t pa_buf;
+static uint16_t pb_bufs[PB_NUM_BUFS];
+#ifdef PERF_HUD
+static uint16_t hud_buf;
+#endif
+static const char * const pb_buf_names[PB_MAX_BUFS] = { "pb-buf-0", "pb-buf-1", "pb-buf-2", "pb-buf-3" };
+
+#ifdef RASTER_BARS
+static const uint16_t bar_colors[] = { 0x0F00, 0x00F0, 0x0FF0, 0x000F };
+#endif
+
+#if defined BOBS || defined BOB_BENCH
+#define BALL_SIZE   16
+
+static BobImage ball;
+static bool ball_ready = false;
+#endif
+
+#ifdef BOBS
+typedef struct {
+    int16_t x;
+    int16_t y;
+    int8_t dx;
+    int8_t dy;
+    int8_t id;
+} DemoBob;
+
+static DemoBob demo_bobs[DEMO_BOBS];
+#endif
+
+#ifdef PROFILE
+static int8_t prof_draw;
+static int8_t prof_line;             // Random lines, or the PA effect
+#ifdef BOBS
+static int8_t prof_bobs;
+#endif
+static int8_t prof_palette;
+static int8_t prof_flip;
+#endif
 
 // Guards against things being optimized out...
 volatile uint32_t opt_guard = 0;
 
 // These are all accessed by the vblank handler
 volatile uint32_t vblank_count = 0;
-volatile uint16_t current_pb_buf = PB_BUF_0;
-volatile uint16_t back_pb_buf = PB_BUF_1;
-volatile bool pb_flip_needed = false;
-
-// Interrupt handler uses these to sync GFX_CTRL changes to VBLANK...
-volatile uint16_t pb_gfx_ctrl = 0x0000;
+volatile uint16_t vblank_timer = 0;
 
 #if !defined(checkchar)        // newer rosco_m68k library addition, this is in case not present
 bool checkchar() {
@@ -125,21 +334,31 @@ static void xcls(uint16_t vaddr, uint16_t len, uint16_t val) {
     xm_setw(WR_ADDR, vaddr);
     xm_setw(WR_INCR, 1);
     xm_setbh(DATA, (val & 0xFF00) >> 8);
-    uint8_t bl = val & 0x00FF;
-
-    for (uint16_t i = 0; i < len; i++) {
-        xm_setbl(DATA, bl);
-    }
+    xb_fill_lo_loop(len, val & 0x00FF);
     xm_setw(WR_ADDR, 0);
 }
 
-static void load_copper_list(uint16_t len, const uint32_t *list) {
-    xm_setw(XR_ADDR, XR_COPPER_MEM);
-
-    for (uint8_t i = 0; i < len; i++) {
-        xm_setw(XR_DATA, list[i] >> 16);
-        xm_setw(XR_DATA, list[i] & 0xffff);
+static void build_raster_list(CopProg *prog) {
+    cop_reset(prog);
+#ifdef PERF_HUD
+    cop_mover(prog, XR_PA_LINE_LEN, 160);                       // Undo the HUD band's line length
+#endif
+    cop_wait_v(prog, 72);                                       // Wait for line 72, H position ignored
+    cop_mover(prog, XR_PA_GFX_CTRL, GFX_MODE_8BPPX2);           // Set to 8-bpp + Hx2 + Vx2
+#ifdef RASTER_FX
+    if (!rfx_build(&raster_fx, &raster_fx_desc, prog)) {
+        dprintf("WARN: Raster effect doesn't fit the copper program\n");
     }
+#endif
+#ifdef SCROLL_CANVAS
+    sc_build(&pa_canvas, prog);                                 // Set LINE_ADDR to ring top, and at wrap
+#endif
+    cop_wait_v(prog, 408);                                      // Wait for line 408, H position ignored
+    cop_mover(prog, XR_PA_GFX_CTRL, GFX_MODE_8BPPX2_BLANK);     // Set to Blank + 8-bpp + Hx2 + Vx2
+#ifdef PERF_HUD
+    hud_build(prog, hud_buf, HUD_TOP);                          // Text row in 1bpp tile mode
+#endif
+    cop_end(prog);                                              // nextf
 }
 
 static void enable_copper() {
@@ -150,8 +369,10 @@ static void disable_copper() {
     xreg_setw(COPP_CTRL, 0x0000);
 }
 
-static uint32_t load_sd_file(const char *filename, uint8_t *buffer) {
+/* Load a whole file, of up to max bytes. Returns the size, or 0 if missing or too big. */
+static uint32_t load_sd_file(const char *filename, uint8_t *buffer, uint32_t max) {
     uint8_t *bufptr = buffer;
+    uint32_t left = max;
     int cnt = 0;
 
     dprintf("Try load: %s\n", filename);
@@ -159,8 +380,17 @@ static uint32_t load_sd_file(const char *filename, uint8_t *buffer) {
     void * file = fl_fopen(filename, "r");
 
     if (file != NULL) {
-        while ((cnt = fl_fread(bufptr, 1, 512, file)) > 0) {
+        while (left && (cnt = fl_fread(bufptr, 1, left < 512 ? left : 512, file)) > 0) {
             bufptr += cnt;
+            left -= cnt;
+        }
+
+        // Buffer's full - anything more and it doesn't fit
+        uint8_t extra;
+        if (!left && fl_fread(&extra, 1, 1, file) > 0) {
+            dprintf("%s is over %lu bytes\n", filename, max);
+            fl_fclose(file);
+            return 0;
         }
 
         fl_fclose(file);
@@ -178,49 +408,164 @@ static void draw_mono_bitmap(uint16_t vaddr, uint8_t *buffer, uint32_t size, uin
     if (size > 0x10000) {
         printf("FAILED; Buffer too large for VRAM...\n");
     } else {
-        for (uint32_t i = 0; i < size; i++) {
-            xm_setbl(DATA, *buffer++);
-        }
+        xb_blit_lo_loop(buffer, size);
     }
 }
 
 /*
- * Loads a maximum of MAX_FRAMES (default: 32) frames numbered 0001-NNNN.
- * If you change from the default max frames, ensure they will fit in
- * memory (without blowing the stack!)
+ * Loads frames numbered 0001-NNNN into the frames RAM pool, one
+ * after the other, until a file is missing or the pool is full.
  *
- * Actual number loaded is returned.
+ * Actual number loaded is returned, and *frames is set to the first.
  */
-static uint8_t load_frames(uint8_t *buffer) {
-    uint8_t *bufptr = buffer;
+static uint16_t load_frames(uint8_t **frames) {
+    uint16_t max_frames = ram_pool_free(RAM_POOL_FRAMES) / FRAME_BYTES;
     char strbuf[21];
 
-    for (int i = 0; i < MAX_FRAMES; i++) {
-        if ((xm_getbl(UNUSED_A) & 0xF) > 3) {
-            pb_gfx_ctrl = GFX_MODE_8BPPX2;
+    dprintf("Room for %d frames\n", max_frames);
+    *frames = ram_next(RAM_POOL_FRAMES);
+
+    for (uint16_t i = 0; i < max_frames; i++) {
+        if ((pafx_rand() & 0xF) > 3) {
+            xrq_put(XR_PB_GFX_CTRL, GFX_MODE_8BPPX2);
         } else {
-            pb_gfx_ctrl = GFX_MODE_8BPPX2_BLANK;
+            xrq_put(XR_PB_GFX_CTRL, GFX_MODE_8BPPX2_BLANK);
         }
 
-        if (sprintf(strbuf, "/" FRAME_DIR "/%04d.xmb", i + 1) < 0) {
+        if (sprintf(strbuf, "/" FRAME_DIR "/%04d." FRAME_EXT, i + 1) < 0) {
             dprintf("sprintf failed!\n");
             return i;
         }
 
-        if (load_sd_file(strbuf, bufptr) != FRAME_SIZE) {
+        // Only claim the slot once it's loaded (the pool is a bump allocator, so slots are consecutive)
+        if (load_sd_file(strbuf, ram_next(RAM_POOL_FRAMES), FRAME_BYTES) != FRAME_BYTES) {
             return i;
         }
+        ram_alloc(RAM_POOL_FRAMES, FRAME_BYTES);
         
         uint8_t color = (i & 0xF);
         if (!color) {
             color = 8;
         }
+    }
+
+    return max_frames;
+}
+
+#ifdef EMBEDDED_FRAMES
+/* Frames are linked in - check they're the format this build plays */
+static uint16_t embedded_frames_ready() {
+    if (embedded_frame_size != FRAME_BYTES) {
+        dprintf("Embedded frames are %lu bytes, expected %d (mono vs colour?)\n", embedded_frame_size, FRAME_BYTES);
+        return 0;
+    }
+
+    return embedded_frame_count;
+}
+#endif
+
+#ifdef COLOR_FRAMES
+/*
+ * Load the 16 colour PB palette. Black is made transparent (like the
+ * background in mono frames) so PA shows through.
+ */
+static bool load_color_palette(uint8_t *temp_buffer) {
+#ifdef EMBEDDED_FRAMES
+    const uint16_t *rgb = embedded_palette;
+    (void)temp_buffer;
+#else
+    if (load_sd_file("/" FRAME_DIR "/palette.xpl", temp_buffer, 32) != 32) {
+        return false;
+    }
+
+    uint16_t *rgb = (uint16_t *)temp_buffer;
+#endif
+
+    xm_setw(XR_ADDR, XR_COLOR_MEM + 0x100);
+    for (int i = 0; i < 16; i++) {
+        xm_setw(XR_DATA, rgb[i] ? 0xC000 | rgb[i] : 0x0000);
+    }
+
+    return true;
+}
+
+/* Colour frames are already attribute + bitmap words, so just stream them */
+static void draw_color_bitmap(uint16_t vaddr, uint8_t *buffer) {
+    xv_copy_to_vram((uint16_t *)buffer, vaddr, FRAME_SIZE * 2);
+}
+#endif
+
+#ifdef TILE_PLAYBACK
+/* Load the shared glyph set into tile memory. temp_buffer needs 2KB. */
+static bool load_glyphs(uint8_t *temp_buffer) {
+    uint32_t size = load_sd_file("/" FRAME_DIR "/glyphs.xtg", temp_buffer, TILE_MAX_GLYPHS * 8);
+
+    if (size == 0 || size > TILE_MAX_GLYPHS * 8 || (size & 7)) {
+        return false;
+    }
+
+    // Two 8 pixel rows per word
+    xm_setw(XR_ADDR, XR_TILE_MEM + TILE_GLYPH_BASE);
+    for (uint32_t i = 0; i < size; i += 2) {
+        xm_setw(XR_DATA, (temp_buffer[i] << 8) | temp_buffer[i + 1]);
+    }
+
+    dprintf("Loaded %lu glyphs\n", size / 8);
+    return true;
+}
+
+/* Tilemap each PB buffer currently holds (NULL if unknown), and its attribute */
+static const uint8_t *pb_buf_maps[PB_NUM_BUFS];
+static uint8_t pb_buf_attrs[PB_NUM_BUFS];
+
+/*
+ * Draw a tilemap into a PB buffer, writing only the entries that differ
+ * from what the buffer already holds. Returns the number of writes.
+ */
+static uint16_t draw_tilemap(uint16_t vaddr, const uint8_t *map, uint8_t attr) {
+    uint8_t b = 0;
+
+    while (b < PB_NUM_BUFS - 1 && pb_bufs[b] != vaddr) {
+        b++;
+    }
+
+    const uint8_t *held = pb_buf_maps[b];
+    uint16_t writes = 0;
+
+    pb_buf_maps[b] = map;
+
+    if (held == NULL || pb_buf_attrs[b] != attr) {
+        pb_buf_attrs[b] = attr;
+        draw_mono_bitmap(vaddr, (uint8_t *)map, TILEMAP_SIZE, attr);
+        return TILEMAP_SIZE + 2;
+    }
+
+    if (held == map) {
+        return 0;
+    }
+
+    // High byte (attribute) stays latched across address changes
+    xm_setbh(DATA, attr);
+    writes++;
+
+    for (uint16_t i = 0; i < TILEMAP_SIZE; i++) {
+        if (map[i] == held[i]) {
+            continue;
+        }
+
+        xm_setw(WR_ADDR, vaddr + i);
+        writes++;
 
-        bufptr += FRAME_SIZE;
+        while (i < TILEMAP_SIZE && map[i] != held[i]) {
+            xm_setbl(DATA, map[i]);
+            writes++;
+            i++;
+        }
     }
 
-    return MAX_FRAMES;
+    return writes;
 }
+#endif
 
 /* Wait until at least one vblank has run */
 static void wait_vblank() {
@@ -238,31 +583,39 @@ static void wait_vblank() {
  * the function, and can be reused after this returns.
  */
 static bool start_loading(uint8_t *temp_buffer) {
-    uint32_t size;
-    if ((size = load_sd_file("/" FRAME_DIR "/Disk.pcx", temp_buffer))) {
-        xcls(PA_8BPP, 38400, 0);
-        xcls(PB_8BPP, 27136, 0);
+#ifdef EMBEDDED_FRAMES
+    uint8_t *image = (uint8_t *)embedded_loading;
+    uint32_t size = embedded_loading_size;
+    (void)temp_buffer;
+#else
+    uint8_t *image = temp_buffer;
+    uint32_t size = load_sd_file("/" FRAME_DIR "/Disk.pcx", temp_buffer, LOAD_BUF_SIZE);
+#endif
 
-        if (!pcx_load_palette(PCX_PALETTE(size, temp_buffer), 0, 0, 0xC000)) {
+    if (size) {
+        xcls(pa_8bpp, LOAD_PA_LEN, 0);
+        xcls(pb_8bpp, LOAD_PB_LEN, 0);
+
+        if (!pcx_load_palette(PCX_PALETTE(size, image), 0, 0, 0xC000)) {
             dprintf("Failed to load loading palette!\n");
             return false;
         }
 
         // Draw main image on PA
-        uint8_t *overlay_start = pcx_draw_image(8, 85, 304, 70, PA_8BPP, PCX_PIXELS(temp_buffer));
+        uint8_t *overlay_start = pcx_draw_image(8, 85, 304, 70, pa_8bpp, PCX_PIXELS(image));
 
         // Draw overlay on PB
-        pcx_draw_image(8, 132, 304, 10, PB_8BPP, overlay_start);
+        pcx_draw_image(8, 132, 304, 10, pb_8bpp, overlay_start);
 
         // Enable playfield displays
         xreg_setw(PA_GFX_CTRL, GFX_MODE_8BPPX2);
         xreg_setw(PA_LINE_LEN, 160);
 
-        pb_gfx_ctrl = GFX_MODE_8BPPX2;
+        xrq_put(XR_PB_GFX_CTRL, GFX_MODE_8BPPX2);
         xreg_setw(PB_LINE_LEN, 160);
 
-        xreg_setw(PA_DISP_ADDR, PA_8BPP);
-        xreg_setw(PB_DISP_ADDR, PB_8BPP);
+        xreg_setw(PA_DISP_ADDR, pa_8bpp);
+        xreg_setw(PB_DISP_ADDR, pb_8bpp);
 
         wait_vblank();
 
@@ -275,24 +628,184 @@ static bool start_loading(uint8_t *temp_buffer) {
 
 static void done_loading() {
     // Just clear and blank PA for now...
-    xcls(PA_BUF, PA_LEN, 0);
-    xreg_setw(PA_DISP_ADDR, PA_BUF);
+    xcls(pa_buf, PA_LEN, 0);
+    xreg_setw(PA_DISP_ADDR, pa_buf);
     // xreg_setw(PA_GFX_CTRL, GFX_MODE_8BPPX2_BLANK);
     wait_vblank();
 }
 
+#ifdef SCROLL_CANVAS
+/* Plots in screen rows, so lines land wherever the ring currently is */
+static void plot_pa_canvas(uint16_t x, uint16_t y, uint8_t color, uint16_t vram_base) {
+    plot_320x200_8bpp(x, sc_row(&pa_canvas, y), color, vram_base);
+}
+#define PA_PLOT     plot_pa_canvas
+#else
+#define PA_PLOT     plot_320x200_8bpp
+#endif
+
 static void random_pa_line() {
-    uint8_t color = xm_getbl(UNUSED_A) & 0x7F;
-    uint16_t x0 = xm_getw(UNUSED_A) % 319;
-    uint16_t y0 = xm_getw(UNUSED_A) % 167; 
-    uint16_t x1 = xm_getw(UNUSED_A) % 319;
-    uint16_t y1 = xm_getw(UNUSED_A) % 167; 
+    uint32_t r = pafx_rand();
+    uint8_t color = r & 0x7F;
+    uint16_t x0 = (r >> 7) % 319;
+    uint16_t y0 = (r >> 16) % 167;
+
+    r = pafx_rand();
+    uint16_t x1 = r % 319;
+    uint16_t y1 = (r >> 16) % 167;
 
 #ifdef LINE_TRACE
     dprintf("Drawing line: (%d,%d),(%d,%d) [color: 0x%02x]\n", x0, y0, x1, y1, color);
 #endif
 
-    xosera_line(x0, y0, x1, y1, color, PA_BUF, plot_320x200_8bpp);
+    xosera_line(x0, y0, x1, y1, color, pa_buf, PA_PLOT);
+}
+
+static uint8_t pa_lines_left = PA_LINES_PER_FRAME;
+static uint16_t pa_clear_row = PA_ROWS;
+
+/* Idle task: this frame's share of random lines, one per slice */
+static bool task_pa_lines(void *ctx) {
+    (void)ctx;
+
+    if (pa_lines_left) {
+        PROF_BEGIN(prof_line);
+        random_pa_line();
+        PROF_END(prof_line);
+        pa_lines_left--;
+    }
+
+    return pa_lines_left > 0;
+}
+
+#ifdef PA_EFFECT
+static uint16_t pa_fx_rows_left = PA_FX_FRAME_ROWS;
+
+/* Idle task: this frame's share of the PA effect, PA_FX_ROWS at a time */
+static bool task_pa_fx(void *ctx) {
+    (void)ctx;
+
+    if (pa_fx_rows_left) {
+        uint16_t rows = pa_fx_rows_left < PA_FX_ROWS ? pa_fx_rows_left : PA_FX_ROWS;
+
+        PROF_BEGIN(prof_line);
+        pafx_step(rows);
+        PROF_END(prof_line);
+        pa_fx_rows_left -= rows;
+    }
+
+    return pa_fx_rows_left > 0;
+}
+#endif
+
+/* Idle task: clear PA a band at a time, rather than all at once */
+static bool task_pa_clear(void *ctx) {
+    (void)ctx;
+
+    if (pa_clear_row < PA_ROWS) {
+        uint16_t rows = PA_ROWS - pa_clear_row;
+
+        if (rows > PA_CLEAR_ROWS) {
+            rows = PA_CLEAR_ROWS;
+        }
+
+        xcls(pa_buf + pa_clear_row * 160, rows * 160, 0);
+        pa_clear_row += rows;
+    }
+
+    return pa_clear_row < PA_ROWS;
+}
+
+#if defined BOBS || defined BOB_BENCH
+/* Shaded ball, in PA palette colours (0 is transparent) */
+static bool init_ball() {
+    static uint8_t pixels[BALL_SIZE * BALL_SIZE];
+
+    if (ball_ready) {
+        return true;
+    }
+
+    for (int16_t y = 0; y < BALL_SIZE; y++) {
+        for (int16_t x = 0; x < BALL_SIZE; x++) {
+            int16_t dx = x * 2 - (BALL_SIZE - 1);
+            int16_t dy = y * 2 - (BALL_SIZE - 1);
+            int16_t d2 = dx * dx + dy * dy;
+            int16_t r2 = BALL_SIZE * BALL_SIZE;
+
+            // Brightest towards the top left
+            int16_t hx = dx + BALL_SIZE / 2;
+            int16_t hy = dy + BALL_SIZE / 2;
+            int16_t shade = 127 - (hx * hx + hy * hy) * 96 / (r2 * 2);
+
+            pixels[y * BALL_SIZE + x] = d2 < r2 ? (shade < 1 ? 1 : shade) : 0;
+        }
+    }
+
+    ball_ready = bob_image_init(&ball, pixels, BALL_SIZE, BALL_SIZE);
+    return ball_ready;
+}
+#endif
+
+#ifdef BOBS
+/* Fixed background (BOBs restore it as they go), then the BOBs on top */
+static bool start_bobs() {
+    for (uint16_t band = 0; band < PA_ROWS / 8; band++) {
+        xv_fill_rect(pa_buf, 160, 0, band * 8, 320, 8, 8, (band & 1) ? 0x1010 : 0x0808);
+    }
+    for (uint16_t col = 0; col < 320; col += 40) {
+        xv_fill_rect(pa_buf, 160, col + 19, 0, 2, PA_ROWS, 8, 0x7F7F);
+    }
+
+    if (!init_ball()) {
+        return false;
+    }
+
+    bob_init(pa_buf, 160, PA_ROWS);
+
+    for (int8_t i = 0; i < DEMO_BOBS; i++) {
+        DemoBob *b = &demo_bobs[i];
+
+        b->id = bob_add(&ball, i);
+        if (b->id < 0) {
+            return false;
+        }
+
+        b->x = 20 + i * 33;
+        b->y = 10 + i * 17;
+        b->dx = (i & 1) ? 2 : -3;
+        b->dy = (i & 2) ? 1 : -2;
+        bob_show(b->id, true);
+    }
+
+    return true;
+}
+
+static uint16_t animate_bobs() {
+    for (int8_t i = 0; i < DEMO_BOBS; i++) {
+        DemoBob *b = &demo_bobs[i];
+
+        b->x += b->dx;
+        b->y += b->dy;
+        if (b->x < 0 || b->x > 320 - BALL_SIZE) {
+            b->dx = -b->dx;
+            b->x += b->dx * 2;
+        }
+        if (b->y < 0 || b->y > PA_ROWS - BALL_SIZE) {
+            b->dy = -b->dy;
+            b->y += b->dy * 2;
+        }
+
+        bob_move(b->id, b->x, b->y);
+    }
+
+    return bob_frame();
+}
+#endif
+
+/* Idle task: send a little of the buffered log */
+static bool task_log(void *ctx) {
+    (void)ctx;
+    return dprint_drain(LOG_DRAIN_CHARS);
 }
 
 void demo_palette(uint8_t component, uint16_t a_blend, uint16_t b_blend) {
@@ -333,6 +846,69 @@ void demo_palette(uint8_t component, uint16_t a_blend, uint16_t b_blend) {
     }
 }
 
+/*
+ * Compile the red/green/blue PA palettes (as demo_palette would write
+ * them) into one-shot copper sequences, so switching component is a
+ * single copper word write rather than 256 palette writes.
+ */
+static bool compile_demo_palettes(uint16_t a_blend) {
+    uint16_t cop_addr = COP_PAL_BASE;
+
+    for (int component = 0; component < 3; component++) {
+        for (int i = 0; i < PA_PAL_COLORS; i++) {
+            if (component == 0) {
+                pa_pal_target[i] = ((i & 0xF0) << 4);
+            } else if (component == 1) {
+                pa_pal_target[i] = (i & 0xF0);
+            } else {
+                pa_pal_target[i] = ((i & 0xF0) >> 4);
+            }
+        }
+
+        // One-frame "fade" is just a set...
+        const PalOp ops[] = {
+            { PAL_OP_FADE, 0, PA_PAL_COLORS - 1, 1, 0, 0, 0, pa_pal_target },
+            { PAL_OP_BLEND, 0, PA_PAL_COLORS - 1, 1, 0, 0, a_blend, NULL },
+        };
+        const PalAnim anim = { NULL, 1, false, 2, ops };
+
+        if (!cop_pal_compile(&anim, cop_addr, COP_PAL_BASE + COP_PAL_WORDS - cop_addr, COP_RASTER_ENTRY, &pa_pal_seqs[component])) {
+            return false;
+        }
+
+        cop_addr += pa_pal_seqs[component].words;
+    }
+
+    dprintf("Palette sequences use %d copper words\n", cop_addr - COP_PAL_BASE);
+    return true;
+}
+
+/*
+ * Lay out VRAM. The loading screen buffers are only needed until
+ * the frames are loaded, so they share space with the playback ones.
+ */
+static bool layout_vram() {
+    vram_reset();
+
+    bool ok = vram_alloc("load-pa", LOAD_PA_LEN, 1, VRAM_PHASE_LOADING, &pa_8bpp)
+           && vram_alloc("load-pb", LOAD_PB_LEN, 1, VRAM_PHASE_LOADING, &pb_8bpp);
+
+    for (int i = 0; ok && i < PB_NUM_BUFS; i++) {
+        ok = vram_alloc(pb_buf_names[i], PB_BUF_LEN, 1, VRAM_PHASE_PLAYBACK, &pb_bufs[i]);
+    }
+
+    ok = ok && vram_alloc("pa-canvas", PA_LEN, 1, VRAM_PHASE_PLAYBACK, &pa_buf);
+#ifdef PERF_HUD
+    ok = ok && vram_alloc("hud-text", HUD_COLS, 1, VRAM_PHASE_PLAYBACK, &hud_buf);
+#endif
+    ok = ok && vram_verify();
+
+    vram_report();
+    pb_present_init(pb_bufs, PB_NUM_BUFS);
+
+    return ok;
+}
+
 void do_initial_blank() {
     xcls(0, 3000, 0);
     xreg_setw(PA_GFX_CTRL, 0x0000);
@@ -348,6 +924,7 @@ void xosera_demo() {
 
     dprintf("Xosera playfield / blend demo (m68k)\n");
 
+#ifndef EMBEDDED_FRAMES
     if (SD_check_support()) {
         dprintf("SD card supported: ");
 
@@ -361,22 +938,60 @@ void xosera_demo() {
         dprintf("No SD card support; quitting.\n");
         return;
     }
+#endif
 
     dprintf("\nxosera_init(1)...");
     // wait for monitor to unblank
     bool success = xosera_init(0);
     dprintf("%s (%dx%d)\n", success ? "succeeded" : "FAILED", xreg_getw(VID_HSIZE), xreg_getw(VID_VSIZE));
 
+    if (!layout_vram()) {
+        dprintf("VRAM layout doesn't fit; quitting\n");
+        return;
+    }
+
+    if (!ram_init(LOAD_BUF_SIZE, SCRATCH_SIZE)) {
+        dprintf("Not enough RAM; quitting\n");
+        return;
+    }
+
     do_initial_blank();
 
-    dprintf("Loading %d bytes of copper list...\n", copper_list_size);
-    load_copper_list(copper_list_size, copper_list);    
+#ifdef BLIT_BENCH
+    xb_bench(pb_8bpp, LOAD_PB_LEN, ram_alloc(RAM_POOL_SCRATCH, SCRATCH_SIZE));   // Loading buffers aren't in use yet
+    ram_release(RAM_POOL_SCRATCH);
+#endif
+#ifdef BOB_BENCH
+    if (init_ball()) {
+        bob_bench(&ball, pa_buf, 160, PA_ROWS);
+    }
+#endif
+#ifdef PA_FX_BENCH
+    pafx_bench(pa_buf, PA_ROWS);
+#endif
+
+    cop_pal_stop(COP_RASTER_ENTRY);
+    cop_raster_init();
+
+    uint16_t pa_blend = 0x0000;
+    if (!compile_demo_palettes(pa_blend)) {
+        dprintf("WARN: Failed to compile palette sequences\n");
+    }
 
-    uint8_t *buffer = (uint8_t*)&_end;
-    uint8_t frame_count;
+    uint8_t *buffer = ram_alloc(RAM_POOL_LOADING, LOAD_BUF_SIZE);
+    uint16_t frame_count;
 
     install_intr();
 
+#ifdef SCROLL_CANVAS
+    sc_init(&pa_canvas, pa_buf, 160, PA_ROWS, 72, 2, XR_PA_LINE_ADDR);
+#endif
+    build_raster_list(&raster_prog);
+    dprintf("Loading %d instructions of copper list...\n", raster_prog.len);
+    if (!cop_raster_present(&raster_prog)) {
+        dprintf("WARN: Failed to load copper list\n");
+    }
+
     dprintf("Loading loading image\n");
 
     if (!start_loading(buffer)) {
@@ -388,75 +1003,234 @@ void xosera_demo() {
     uint8_t palette_component = 1;
     uint8_t anim_cycles = 0;
 
-    if ((frame_count = load_frames(buffer))) {
-        dprintf("Loaded %d frames\n", frame_count);
+#ifdef EMBEDDED_FRAMES
+    uint8_t *frames = (uint8_t *)embedded_frames;
+    frame_count = embedded_frames_ready();
+#else
+    uint8_t *frames;
+    frame_count = load_frames(&frames);
+#endif
+
+    if (frame_count) {
+        dprintf("Loaded %u frames\n", frame_count);
+
+#ifdef TILE_PLAYBACK
+        if (!load_glyphs(ram_alloc(RAM_POOL_SCRATCH, TILE_MAX_GLYPHS * 8))) {
+            dprintf("Failed to load glyphs; quitting\n");
+            done_loading();
+            remove_intr();
+            return;
+        }
+#endif
 
         done_loading();
         enable_copper();
         demo_palette(0, 0x0000, 0xc000);
 
+#ifdef COLOR_FRAMES
+        if (!load_color_palette(ram_alloc(RAM_POOL_SCRATCH, 32))) {
+            dprintf("WARN: Failed to load colour palette\n");
+        }
+#endif
+
+        // Loading image and file buffers are done with
+        ram_release(RAM_POOL_SCRATCH);
+        ram_release(RAM_POOL_LOADING);
+        ram_report();
+
+#ifdef PERF_HUD
+        hud_init(hud_buf);
+        hud_text(0, HUD_ATTR_LABEL, "FPS");
+        hud_text(9, HUD_ATTR_LABEL, "MS");
+        hud_text(17, HUD_ATTR_LABEL, "DROP");
+        hud_text(28, HUD_ATTR_LABEL, "WR");
+
+        uint16_t hud_last = xm_getw(TIMER);
+        uint16_t hud_writes = 0;
+#endif
+
         // N.B. From here on out, PA_GFX_CTRL is under control of copper...
 
-        pb_gfx_ctrl = GFX_MODE_1BPPX2;
+#ifdef TILE_PLAYBACK
+        xreg_setw(PB_TILE_CTRL, MAKE_TILE_CTRL(TILE_GLYPH_BASE, 0, 8));
+        xrq_put(XR_PB_GFX_CTRL, GFX_MODE_1BPPX2_TILE);
+#else
+        xrq_put(XR_PB_GFX_CTRL, GFX_MODE_1BPPX2);
+#endif
         xreg_setw(PB_LINE_LEN, 40);
 
-        uint8_t current_frame = frame_count;
-        uint8_t *bufptr = buffer;
+        uint16_t current_frame = frame_count;
+        uint8_t *bufptr = frames;
 #if defined SLOW_CYCLE || defined PSYCHEDELIC
         uint16_t counter = 0;
 #endif
         uint8_t attr = ATTR;
 
 #ifdef LINE_TEST
-        xosera_line(0, 0, 319, 0, 127, PA_BUF, plot_320x200_8bpp);
-        xosera_line(0, 167, 319, 167, 127, PA_BUF, plot_320x200_8bpp);
-        xosera_line(0, 0, 0, 167, 127, PA_BUF, plot_320x200_8bpp);
-        xosera_line(319, 0, 319, 167, 127, PA_BUF, plot_320x200_8bpp);
+        xosera_line(0, 0, 319, 0, 127, pa_buf, plot_320x200_8bpp);
+        xosera_line(0, 167, 319, 167, 127, pa_buf, plot_320x200_8bpp);
+        xosera_line(0, 0, 0, 167, 127, pa_buf, plot_320x200_8bpp);
+        xosera_line(319, 0, 319, 167, 127, pa_buf, plot_320x200_8bpp);
 
-        xosera_line(0, 0, 319, 167, 127, PA_BUF, plot_320x200_8bpp);
-        xosera_line(0, 167, 319, 0, 127, PA_BUF, plot_320x200_8bpp);
+        xosera_line(0, 0, 319, 167, 127, pa_buf, plot_320x200_8bpp);
+        xosera_line(0, 167, 319, 0, 127, pa_buf, plot_320x200_8bpp);
+#endif
+
+        sched_init(FRAME_VBLANKS);
+#ifdef BOBS
+        if (!start_bobs()) {
+            dprintf("WARN: Failed to set up BOBs\n");
+        }
+#elif defined PA_EFFECT
+        pafx_init(PA_EFFECT, pa_buf, PA_ROWS);
+        sched_add_task(task_pa_fx, NULL, 40);
+#else
+        sched_add_task(task_pa_lines, NULL, 20);
+        sched_add_task(task_pa_clear, NULL, 30);
+#endif
+        sched_add_task(task_log, NULL, LOG_DRAIN_TICKS);
+
+        // Logging from here on mustn't hold up frames
+        dprint_buffered(true);
+
+#ifdef PROFILE
+        // Bucket widths in 1/10ms, 32 buckets each
+        prof_draw = prof_scope("draw_mono_bitmap", 5, BAR_DRAW);
+#ifdef PA_EFFECT
+        prof_line = prof_scope("pa_effect", 2, BAR_LINE);
+#else
+        prof_line = prof_scope("random_pa_line", 1, BAR_LINE);
+#endif
+#ifdef BOBS
+        prof_bobs = prof_scope("bob_frame", 2, BAR_LINE);
+#endif
+        prof_palette = prof_scope("palette", 2, BAR_PALETTE);
+        prof_flip = prof_scope("flip_wait", 5, BAR_FLIP);   // Includes idle tasks run while waiting
+        uint8_t prof_loops = 0;
+#endif
+#ifdef RASTER_BARS
+        for (int i = 0; i < 4; i++) {
+            xmem_setw(XR_COLOR_MEM + BAR_COLOR_BASE + i, bar_colors[i]);
+        }
+
+        // 848 wide modes have 517 lines per frame, 640 wide have 525
+        prof_bars(true, xreg_getw(VID_HSIZE) == 848 ? 517 : 525);
 #endif
 
         while (true) {     
+#ifdef PROFILE
+            if (checkchar()) {
+                readchar();
+                prof_report();
+                prof_reset();
+            }
+#endif
+
             if (current_frame == frame_count) {
-                demo_palette(palette_component++, 0x0000, 0xc000);
+                PROF_BEGIN(prof_palette);
+
+                if (anim_cycles++ == 10) {
+                    // Sequences must be parked while they're rewritten
+                    cop_pal_stop(COP_RASTER_ENTRY);
+                    wait_vblank();
+
+                    pa_blend ^= PA_BLEND_ALT;
+                    compile_demo_palettes(pa_blend);
+#if !defined SCROLL_CANVAS && !defined BOBS && !defined PA_EFFECT
+                    pa_clear_row = 0;
+#endif
+                    sched_report();
+                    pb_report();
+                }
+
+                // Copper writes the palette during the next vblank
+                cop_pal_start(&pa_pal_seqs[palette_component++]);
 
                 if (palette_component == 3) {
                     palette_component = 0;
                 }
 
-                if (anim_cycles++ == 10) {
-                    // TODO change palette blend mode here...
-                    xcls(PA_BUF, PA_LEN, 0);
+                PROF_END(prof_palette);
+
+#ifdef PROFILE
+                if (++prof_loops == PROF_REPORT_LOOPS) {
+                    prof_report();
+                    prof_reset();
+                    prof_loops = 0;
                 }
+#endif
 
                 current_frame = 0;
-                bufptr = buffer;
+                bufptr = frames;
             }
 
-            random_pa_line();
-            random_pa_line();
+#ifdef SCROLL_CANVAS
+            sc_advance(&pa_canvas, &raster_prog, 0);
+#endif
 
-            draw_mono_bitmap(back_pb_buf, bufptr, FRAME_SIZE, attr);
-            pb_flip_needed = true;
+            uint16_t pb_addr = sched_begin_frame();
 
-            int count = 0;
-            while (pb_flip_needed) { 
-                // wait for flip
-                if (count++ == 100000) {
-                    dprintf("Still waiting for flip (after %d vblanks)...\n", vblank_count);
-                    count = 0;
-                }        
-            }
+            PROF_BEGIN(prof_draw);
+#ifdef TILE_PLAYBACK
+            uint16_t draw_writes = draw_tilemap(pb_addr, bufptr, attr);
+#elif defined COLOR_FRAMES
+            draw_color_bitmap(pb_addr, bufptr);
+            uint16_t draw_writes = FRAME_SIZE / 2 + 2;              // MOVEP.L, two words at a time
+            (void)attr;
+#else
+            draw_mono_bitmap(pb_addr, bufptr, FRAME_SIZE, attr);
+            uint16_t draw_writes = FRAME_SIZE + 2;
+#endif
+            (void)draw_writes;                                      // Only used by PERF_HUD
+            PROF_END(prof_draw);
+
+#ifdef BOBS
+            PROF_BEGIN(prof_bobs);
+            draw_writes += animate_bobs();
+            PROF_END(prof_bobs);
+#endif
 
-            count = 0;
-            while (count++ < 10000) {
-                // busywait...
-                opt_guard++;
+#ifdef RASTER_FX
+            rfx_animate(&raster_fx, &raster_prog);
+#endif
+#if defined RASTER_FX || defined SCROLL_CANVAS
+            cop_raster_present(&raster_prog);
+#endif
+#ifdef PERF_HUD
+            // Roughly: frame draw, copper upload, last HUD update
+            uint32_t frame_writes = draw_writes + hud_writes;
+#if defined RASTER_FX || defined SCROLL_CANVAS
+            frame_writes += cop_raster_last_writes();
+#endif
+#endif
+
+            // Queue for this frame's vblank - next frame can be drawn meanwhile
+            PROF_BEGIN(prof_flip);
+            sched_present();
+            PROF_END(prof_flip);
+#ifdef PROFILE
+            prof_frame();
+#endif
+#ifdef PERF_HUD
+            uint16_t now = xm_getw(TIMER);
+            uint16_t frame_ticks = now - hud_last;
+            hud_last = now;
+
+            if (frame_ticks) {
+                hud_number(4, 4, 1, 100000UL / frame_ticks);
+                hud_number(12, 4, 1, frame_ticks);
             }
+            hud_number(22, 5, 0, sched_stats()->dropped);
+            hud_number(31, 5, 0, frame_writes);
+            hud_writes = hud_update(HUD_MAX_WRITES);
+#endif
+            pa_lines_left = PA_LINES_PER_FRAME;
+#ifdef PA_EFFECT
+            pa_fx_rows_left = PA_FX_FRAME_ROWS;
+#endif
 
             current_frame++;
-            bufptr += FRAME_SIZE;
+            bufptr += FRAME_BYTES;
 
 #ifdef SLOW_CYCLE
             switch (counter++) {
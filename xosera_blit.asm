@@ -0,0 +1,203 @@
+; *************************************************************
+; Copyright (c) 2021 roscopeco <AT> gmail <DOT> com
+; *************************************************************
+;
+; Bulk VRAM transfer kernels (see xosera_blit.h for the C side)
+;
+; Two kinds of inner loop:
+;
+;   Loop mode - the 68010 spots a single one-word instruction followed
+;   by a DBRA back to it, and runs it without fetching either opcode
+;   again. That fits anything that's one byte write per VRAM word to
+;   the same place: XM_DATA's low byte, with the high byte set once
+;   beforehand (fills, and byte streams with a fixed attribute).
+;
+;   Unrolled MOVEP.L - four bytes (two VRAM words, through XM_DATA and
+;   XM_DATA_2) per instruction, eight to a loop. MOVEP isn't loopable,
+;   but this moves whole words, so it's the way to copy to and from
+;   VRAM.
+;
+; Kernels only move data: the caller sets up WR_ADDR / RD_ADDR, the
+; increments and (for the low byte kernels) XM_DATA's high byte.
+; Counts are 32 bits. GCC calling convention - arguments are longs on
+; the stack, D0-D1/A0-A1 are scratch.
+;
+        section .text                     ; This is normal code
+
+        include "xosera_m68k_defs.inc"
+
+; void xb_fill_lo_loop(uint32_t count, uint32_t low_byte)
+xb_fill_lo_loop::
+                move.l  4(A7),D0                ; count
+                beq.s   .DONE
+                move.l  8(A7),D1                ; low byte
+                move.l  #XM_BASEADDR+XM_DATA+2,A0
+                subq.l  #1,D0
+
+.LOOP           move.b  D1,(A0)                 ; Loop mode
+                dbra    D0,.LOOP
+                sub.l   #$10000,D0              ; DBRA only counts 16 bits...
+                bpl.s   .LOOP                   ; ... so go round again per 64K
+
+.DONE           rts
+
+; void xb_blit_lo_loop(const uint8_t *src, uint32_t count)
+xb_blit_lo_loop::
+                move.l  4(A7),A1                ; src
+                move.l  8(A7),D0                ; count
+                beq.s   .DONE
+                move.l  #XM_BASEADDR+XM_DATA+2,A0
+                subq.l  #1,D0
+
+.LOOP           move.b  (A1)+,(A0)              ; Loop mode
+                dbra    D0,.LOOP
+                sub.l   #$10000,D0
+                bpl.s   .LOOP
+
+.DONE           rts
+
+; void xb_blit_lo_unrolled(const uint8_t *src, uint32_t count)
+;
+; Same as xb_blit_lo_loop, for comparison - eight writes per DBRA, but
+; every opcode is fetched each time.
+xb_blit_lo_unrolled::
+                move.l  D2,-(A7)
+                move.l  8(A7),A1                ; src
+                move.l  12(A7),D0               ; count
+                move.l  #XM_BASEADDR,A0
+
+                moveq.l #7,D2                   ; Odd bytes first...
+                and.w   D0,D2
+                lsr.l   #3,D0                   ; ... then blocks of eight
+                bra.s   .REST_TEST
+
+.REST           move.b  (A1)+,XM_DATA+2(A0)
+.REST_TEST      dbra    D2,.REST
+                bra.s   .BLOCK_TEST
+
+.BLOCK          move.b  (A1)+,XM_DATA+2(A0)
+                move.b  (A1)+,XM_DATA+2(A0)
+                move.b  (A1)+,XM_DATA+2(A0)
+                move.b  (A1)+,XM_DATA+2(A0)
+                move.b  (A1)+,XM_DATA+2(A0)
+                move.b  (A1)+,XM_DATA+2(A0)
+                move.b  (A1)+,XM_DATA+2(A0)
+                move.b  (A1)+,XM_DATA+2(A0)
+.BLOCK_TEST     dbra    D0,.BLOCK
+                sub.l   #$10000,D0
+                bpl.s   .BLOCK
+
+                move.l  (A7)+,D2
+                rts
+
+; void xb_fill_l_unrolled(uint32_t longs, uint32_t long_value)
+xb_fill_l_unrolled::
+                move.l  D2,-(A7)
+                move.l  8(A7),D0                ; longs (two VRAM words each)
+                move.l  12(A7),D1               ; value (word repeated)
+                move.l  #XM_BASEADDR,A0
+
+                moveq.l #7,D2
+                and.w   D0,D2
+                lsr.l   #3,D0
+                bra.s   .REST_TEST
+
+.REST           movep.l D1,XM_DATA(A0)
+.REST_TEST      dbra    D2,.REST
+                bra.s   .BLOCK_TEST
+
+.BLOCK          movep.l D1,XM_DATA(A0)
+                movep.l D1,XM_DATA(A0)
+                movep.l D1,XM_DATA(A0)
+                movep.l D1,XM_DATA(A0)
+                movep.l D1,XM_DATA(A0)
+                movep.l D1,XM_DATA(A0)
+                movep.l D1,XM_DATA(A0)
+                movep.l D1,XM_DATA(A0)
+.BLOCK_TEST     dbra    D0,.BLOCK
+                sub.l   #$10000,D0
+                bpl.s   .BLOCK
+
+                move.l  (A7)+,D2
+                rts
+
+; void xb_copy_to_l_unrolled(const uint32_t *src, uint32_t longs)
+xb_copy_to_l_unrolled::
+                move.l  D2,-(A7)
+                move.l  8(A7),A1                ; src
+                move.l  12(A7),D0               ; longs
+                move.l  #XM_BASEADDR,A0
+
+                moveq.l #7,D2
+                and.w   D0,D2
+                lsr.l   #3,D0
+                bra.s   .REST_TEST
+
+.REST           move.l  (A1)+,D1
+                movep.l D1,XM_DATA(A0)
+.REST_TEST      dbra    D2,.REST
+                bra.s   .BLOCK_TEST
+
+.BLOCK          move.l  (A1)+,D1
+                movep.l D1,XM_DATA(A0)
+                move.l  (A1)+,D1
+                movep.l D1,XM_DATA(A0)
+                move.l  (A1)+,D1
+                movep.l D1,XM_DATA(A0)
+                move.l  (A1)+,D1
+                movep.l D1,XM_DATA(A0)
+                move.l  (A1)+,D1
+                movep.l D1,XM_DATA(A0)
+                move.l  (A1)+,D1
+                movep.l D1,XM_DATA(A0)
+                move.l  (A1)+,D1
+                movep.l D1,XM_DATA(A0)
+                move.l  (A1)+,D1
+                movep.l D1,XM_DATA(A0)
+.BLOCK_TEST     dbra    D0,.BLOCK
+                sub.l   #$10000,D0
+                bpl.s   .BLOCK
+
+                move.l  (A7)+,D2
+                rts
+
+; void xb_copy_from_l_unrolled(uint32_t *dest, uint32_t longs)
+xb_copy_from_l_unrolled::
+                move.l  D2,-(A7)
+                move.l  8(A7),A1                ; dest
+                move.l  12(A7),D0               ; longs
+                move.l  #XM_BASEADDR,A0
+
+                moveq.l #7,D2
+                and.w   D0,D2
+                lsr.l   #3,D0
+                bra.s   .REST_TEST
+
+.REST           movep.l XM_DATA(A0),D1
+                move.l  D1,(A1)+
+.REST_TEST      dbra    D2,.REST
+                bra.s   .BLOCK_TEST
+
+.BLOCK          movep.l XM_DATA(A0),D1
+                move.l  D1,(A1)+
+                movep.l XM_DATA(A0),D1
+                move.l  D1,(A1)+
+                movep.l XM_DATA(A0),D1
+                move.l  D1,(A1)+
+                movep.l XM_DATA(A0),D1
+                move.l  D1,(A1)+
+                movep.l XM_DATA(A0),D1
+                move.l  D1,(A1)+
+                movep.l XM_DATA(A0),D1
+                move.l  D1,(A1)+
+                movep.l XM_DATA(A0),D1
+                move.l  D1,(A1)+
+                movep.l XM_DATA(A0),D1
+                move.l  D1,(A1)+
+.BLOCK_TEST     dbra    D0,.BLOCK
+                sub.l   #$10000,D0
+                bpl.s   .BLOCK
+
+                move.l  (A7)+,D2
+                rts
+
@@ -0,0 +1,180 @@
+/*
+ * vim: set et ts=4 sw=4
+ *------------------------------------------------------------
+ *                                  ___ ___ _
+ *  ___ ___ ___ ___ ___       _____|  _| . | |_
+ * |  _| . |_ -|  _| . |     |     | . | . | '_|
+ * |_| |___|___|___|___|_____|_|_|_|___|___|_,_|
+ *                     |_____|
+ * ------------------------------------------------------------
+ * Copyright (c) 2021 Ross Bamford
+ * MIT License
+ *
+ * Bulk VRAM transfer kernel benchmark
+ * ------------------------------------------------------------
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "xosera_m68k_api.h"
+#include "xosera_blit.h"
+#include "dprint.h"
+
+#define BENCH_SIZES     3
+#define BENCH_MIN_TICKS 200             // Keep repeating for at least 20ms
+
+static const uint32_t bench_bytes[BENCH_SIZES] = { 64, 1024, 16384 };
+
+static uint16_t bench_vaddr;
+static uint8_t *bench_ram;
+
+static void start_write() {
+    xm_setw(WR_ADDR, bench_vaddr);
+    xm_setw(WR_INCR, 1);
+    xm_setbh(DATA, 0x0F);
+}
+
+static void start_read() {
+    xm_setw(RD_ADDR, bench_vaddr);
+    xm_setw(RD_INCR, 1);
+}
+
+// The plain C loops the kernels replace (as in xcls, draw_mono_bitmap and xv_*)
+static void fill_lo_c(uint32_t bytes) {
+    start_write();
+    for (uint32_t i = 0; i < bytes / 2; i++) {
+        xm_setbl(DATA, 0x55);
+    }
+}
+
+static void fill_lo_loop(uint32_t bytes) {
+    start_write();
+    xb_fill_lo_loop(bytes / 2, 0x55);
+}
+
+static void fill_l_c(uint32_t bytes) {
+    start_write();
+    for (uint32_t i = 0; i < bytes / 4; i++) {
+        xm_setl(DATA, 0x0F550F55);
+    }
+}
+
+static void fill_l_unrolled(uint32_t bytes) {
+    start_write();
+    xb_fill_l_unrolled(bytes / 4, 0x0F550F55);
+}
+
+static void blit_lo_c(uint32_t bytes) {
+    uint8_t *src = bench_ram;
+
+    start_write();
+    for (uint32_t i = 0; i < bytes / 2; i++) {
+        xm_setbl(DATA, *src++);
+    }
+}
+
+static void blit_lo_loop(uint32_t bytes) {
+    start_write();
+    xb_blit_lo_loop(bench_ram, bytes / 2);
+}
+
+static void blit_lo_unrolled(uint32_t bytes) {
+    start_write();
+    xb_blit_lo_unrolled(bench_ram, bytes / 2);
+}
+
+static void copy_to_c(uint32_t bytes) {
+    uint32_t *src = (uint32_t *)bench_ram;
+
+    start_write();
+    for (uint32_t i = 0; i < bytes / 4; i++) {
+        xm_setl(DATA, *src++);
+    }
+}
+
+static void copy_to_unrolled(uint32_t bytes) {
+    start_write();
+    xb_copy_to_l_unrolled((uint32_t *)bench_ram, bytes / 4);
+}
+
+static void copy_from_c(uint32_t bytes) {
+    uint32_t *dest = (uint32_t *)bench_ram;
+
+    start_read();
+    for (uint32_t i = 0; i < bytes / 4; i++) {
+        *dest++ = xm_getl(DATA);
+    }
+}
+
+static void copy_from_unrolled(uint32_t bytes) {
+    start_read();
+    xb_copy_from_l_unrolled((uint32_t *)bench_ram, bytes / 4);
+}
+
+typedef struct {
+    const char  *name;
+    void        (*run)(uint32_t bytes);
+} BenchKernel;
+
+static const BenchKernel kernels[] = {
+    { "fill lo    C",        fill_lo_c },
+    { "fill lo    loop",     fill_lo_loop },
+    { "fill word  C",        fill_l_c },
+    { "fill word  unrolled", fill_l_unrolled },
+    { "blit attr  C",        blit_lo_c },
+    { "blit attr  loop",     blit_lo_loop },
+    { "blit attr  unrolled", blit_lo_unrolled },
+    { "copy to    C",        copy_to_c },
+    { "copy to    unrolled", copy_to_unrolled },
+    { "copy from  C",        copy_from_c },
+    { "copy from  unrolled", copy_from_unrolled },
+};
+
+// VRAM bytes per ms moving bytes at a time, repeating for at least BENCH_MIN_TICKS
+static uint32_t bench_rate(const BenchKernel *kernel, uint32_t bytes) {
+    uint32_t reps = 0;
+    uint32_t ticks = 0;
+
+    kernel->run(bytes);                 // Warm up
+
+    uint16_t start = xm_getw(TIMER);
+    while (ticks < BENCH_MIN_TICKS) {
+        kernel->run(bytes);
+        reps++;
+        ticks = (uint16_t)(xm_getw(TIMER) - start);
+    }
+
+    return (bytes * reps * 10) / ticks;
+}
+
+void xb_bench(uint16_t vaddr, uint16_t vwords, uint8_t *ram) {
+    if (vwords < bench_bytes[BENCH_SIZES - 1] / 2) {
+        dprintf("Blit bench needs %lu words of VRAM\n", bench_bytes[BENCH_SIZES - 1] / 2);
+        return;
+    }
+
+    bench_vaddr = vaddr;
+    bench_ram = ram;
+
+    for (uint32_t i = 0; i < bench_bytes[BENCH_SIZES - 1]; i++) {
+        ram[i] = i;
+    }
+
+    dprintf("\nVRAM transfer, bytes/ms\n");
+    dprintf("%-20s", "kernel");
+    for (int s = 0; s < BENCH_SIZES; s++) {
+        dprintf(" %8luB", bench_bytes[s]);
+    }
+    dprintf("\n");
+
+    for (uint16_t k = 0; k < sizeof(kernels) / sizeof(kernels[0]); k++) {
+        dprintf("%-20s", kernels[k].name);
+        for (int s = 0; s < BENCH_SIZES; s++) {
+            dprintf(" %9lu", bench_rate(&kernels[k], bench_bytes[s]));
+        }
+        dprintf("\n");
+    }
+
+    dprintf("\n");
+}
@@ -0,0 +1,55 @@
+/*
+ * vim: set et ts=4 sw=4
+ *------------------------------------------------------------
+ *                                  ___ ___ _
+ *  ___ ___ ___ ___ ___       _____|  _| . | |_
+ * |  _| . |_ -|  _| . |     |     | . | . | '_|
+ * |_| |___|___|___|___|_____|_|_|_|___|___|_,_|
+ *                     |_____|
+ * ------------------------------------------------------------
+ * Copyright (c) 2021 Ross Bamford
+ * MIT License
+ *
+ * Bulk VRAM transfer kernels (68010 loop mode and unrolled
+ * MOVEP.L, in xosera_blit.asm)
+ *
+ * The kernels only move data - the caller sets WR_ADDR or
+ * RD_ADDR and the increment first, and for the _lo kernels,
+ * XM_DATA's high byte (which every word written then shares).
+ * xv_vram_fill(), xv_copy_to_vram() and xv_copy_from_vram()
+ * use them above the size thresholds below.
+ *
+ * xb_bench() times every kernel against the plain C loops it
+ * replaces and prints a bytes/ms table. Run it (BLIT_BENCH
+ * in the demo) on real hardware to set the thresholds.
+ * ------------------------------------------------------------
+ */
+
+#if !defined(XOSERA_BLIT_H)
+#define XOSERA_BLIT_H
+
+#include <stdint.h>
+
+// Below these sizes, the C loops win (no call or loop setup)
+#define XB_FILL_LOOP_MIN    16      // Words
+#define XB_COPY_UNROLL_MIN  16      // Longs (two words each)
+
+// Loop mode: one byte write per word, to XM_DATA's low byte
+void xb_fill_lo_loop(uint32_t count, uint32_t low_byte);
+void xb_blit_lo_loop(const uint8_t *src, uint32_t count);
+
+// Unrolled (eight per DBRA)
+void xb_blit_lo_unrolled(const uint8_t *src, uint32_t count);
+void xb_fill_l_unrolled(uint32_t longs, uint32_t long_value);
+void xb_copy_to_l_unrolled(const uint32_t *src, uint32_t longs);
+void xb_copy_from_l_unrolled(uint32_t *dest, uint32_t longs);
+
+/*
+ * Time each kernel and its C equivalent at a few sizes, and
+ * print bytes/ms (VRAM bytes - two per word). Needs vwords
+ * (at least 8192) of scratch VRAM at vaddr, and vwords * 2
+ * bytes of RAM at ram, and overwrites both.
+ */
+void xb_bench(uint16_t vaddr, uint16_t vwords, uint8_t *ram);
+
+#endif
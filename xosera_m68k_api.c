@@ -28,6 +28,7 @@
 
 #define XV_PREP_REQUIRED
 #include "xosera_m68k_api.h"
+#include "xosera_blit.h"
 
 void xv_delay(uint32_t ms)
 {
@@ -106,6 +107,13 @@ void xv_vram_fill(uint32_t vram_addr, uint32_t numwords, uint32_t word_value)
 
     xm_setw(WR_ADDR, (uint16_t)vram_addr);
     xm_setw(WR_INCR, 1);
+    if (numwords >= XB_FILL_LOOP_MIN)
+    {
+        // every word has the same high byte, so a loop mode kernel only writes the low one
+        xm_setbh(DATA, (uint8_t)(word_value >> 8));
+        xb_fill_lo_loop(numwords, word_value & 0xff);
+        return;
+    }
     uint32_t long_value = (word_value << 16) | (uint16_t)(word_value & 0xffff);
     if (numwords & 1)
     {
@@ -131,6 +139,11 @@ void xv_copy_to_vram(uint16_t * source, uint32_t vram_dest, uint32_t numbytes)
     }
     uint32_t * long_ptr  = (uint32_t *)source;
     uint32_t   long_size = numbytes >> 2;
+    if (long_size >= XB_COPY_UNROLL_MIN)
+    {
+        xb_copy_to_l_unrolled(long_ptr, long_size);
+        return;
+    }
     while (long_size--)
     {
         xm_setl(DATA, *long_ptr++);
@@ -150,12 +163,280 @@ void xv_copy_from_vram(uint32_t vram_source, uint16_t * dest, uint32_t numbytes)
     }
     uint32_t * long_ptr  = (uint32_t *)dest;
     uint32_t   long_size = numbytes >> 2;
+    if (long_size >= XB_COPY_UNROLL_MIN)
+    {
+        xb_copy_from_l_unrolled(long_ptr, long_size);
+        return;
+    }
     while (long_size--)
     {
         *long_ptr++ = xm_getl(DATA);
     }
 }
 
+// Rectangles
+//
+// Each row is one WR_ADDR/RD_ADDR write, then auto-increment across it. Edge words that are only partly inside the
+// rectangle are written through the SYS_CTRL nibble write mask rather than read-modify-write, so rows always go out as
+// whole words (in bulk, with the xosera_blit kernels). Rows that don't start on a word boundary are shifted into line
+// first, a word at a time.
+
+#define XV_RECT_MAX_WORDS 512        // Widest row (in VRAM words) copied via row_buf
+
+static uint16_t row_buf[XV_RECT_MAX_WORDS + 1];
+
+typedef struct
+{
+    uint16_t first;             // first word of the row (relative to row start)
+    uint16_t words;             // words touched per row
+    uint8_t  phase;             // bits into the first word the rectangle starts
+    uint8_t  left_mask;         // SYS_CTRL write mask for first and last words (0xF == whole word)
+    uint8_t  right_mask;
+    uint32_t row_bytes;         // packed RAM bytes per row
+} xv_rect_span;
+
+static bool rect_span(uint16_t x, uint16_t width, uint8_t bpp, xv_rect_span * span)
+{
+    uint32_t start = (uint32_t)x * bpp;
+    uint32_t end   = start + (uint32_t)width * bpp;
+
+    if (width == 0 || (start & 3) || (end & 3))
+    {
+        return false;        // write mask is per nibble, so edges must be too
+    }
+
+    span->first      = start >> 4;
+    span->words      = ((end + 15) >> 4) - span->first;
+    span->phase      = start & 15;
+    span->left_mask  = 0xF >> (span->phase >> 2);
+    span->right_mask = (end & 15) ? (0xF << (4 - ((end & 15) >> 2))) & 0xF : 0xF;
+    span->row_bytes  = (end - start + 7) >> 3;
+
+    if (span->words == 1)
+    {
+        span->left_mask &= span->right_mask;
+        span->right_mask = span->left_mask;
+    }
+
+    return span->words <= XV_RECT_MAX_WORDS;
+}
+
+static void write_words(const uint16_t * words, uint16_t count)
+{
+    xv_prep();
+
+    if (count & 1)
+    {
+        xm_setw(DATA, *words++);
+    }
+    uint32_t long_size = count >> 1;
+    if (long_size >= XB_COPY_UNROLL_MIN)
+    {
+        xb_copy_to_l_unrolled((const uint32_t *)words, long_size);
+    }
+    else
+    {
+        const uint32_t * long_ptr = (const uint32_t *)words;
+        while (long_size--)
+        {
+            xm_setl(DATA, *long_ptr++);
+        }
+    }
+}
+
+// Shift a packed RAM row so it lines up with VRAM words (row_buf[0] holds the first, partial, word)
+static const uint16_t * align_row(const uint8_t * source, const xv_rect_span * span)
+{
+    if (span->phase == 0 && !((uintptr_t)source & 1))
+    {
+        return (const uint16_t *)source;        // already word aligned
+    }
+
+    const uint8_t * end   = source + span->row_bytes;
+    uint32_t        acc   = 0;
+    uint8_t         have  = span->phase;        // leading bits of the first word are masked off anyway
+
+    for (uint16_t w = 0; w < span->words; w++)
+    {
+        while (have < 16)
+        {
+            acc = (acc << 8) | (source < end ? *source++ : 0);
+            have += 8;
+        }
+        have -= 16;
+        row_buf[w] = (uint16_t)(acc >> have);
+    }
+
+    return row_buf;
+}
+
+void xv_copy_rect(const uint8_t * source,
+                  uint32_t        source_stride,
+                  uint16_t        vram_base,
+                  uint16_t        vram_stride,
+                  uint16_t        x,
+                  uint16_t        y,
+                  uint16_t        width,
+                  uint16_t        height,
+                  uint8_t         bpp)
+{
+    xv_prep();
+
+    xv_rect_span span;
+    if (!rect_span(x, width, bpp, &span))
+    {
+        return;
+    }
+
+    uint16_t addr = vram_base + y * vram_stride + span.first;
+    xm_setw(WR_INCR, 1);
+
+    while (height--)
+    {
+        const uint16_t * words = align_row(source, &span);
+        uint16_t         count = span.words;
+
+        xm_setw(WR_ADDR, addr);
+        if (span.left_mask != 0xF)
+        {
+            xm_setbl(SYS_CTRL, span.left_mask);
+            xm_setw(DATA, *words++);
+            xm_setbl(SYS_CTRL, 0xF);
+            count--;
+        }
+        if (count && span.right_mask != 0xF)
+        {
+            write_words(words, count - 1);
+            xm_setbl(SYS_CTRL, span.right_mask);
+            xm_setw(DATA, words[count - 1]);
+            xm_setbl(SYS_CTRL, 0xF);
+        }
+        else
+        {
+            write_words(words, count);
+        }
+
+        source += source_stride;
+        addr += vram_stride;
+    }
+}
+
+void xv_fill_rect(uint16_t vram_base,
+                  uint16_t vram_stride,
+                  uint16_t x,
+                  uint16_t y,
+                  uint16_t width,
+                  uint16_t height,
+                  uint8_t  bpp,
+                  uint16_t word_value)
+{
+    xv_prep();
+
+    xv_rect_span span;
+    if (!rect_span(x, width, bpp, &span))
+    {
+        return;
+    }
+
+    uint16_t addr = vram_base + y * vram_stride + span.first;
+    xm_setw(WR_INCR, 1);
+
+    while (height--)
+    {
+        uint16_t count = span.words;
+
+        xm_setw(WR_ADDR, addr);
+        if (span.left_mask != 0xF)
+        {
+            xm_setbl(SYS_CTRL, span.left_mask);
+            xm_setw(DATA, word_value);
+            xm_setbl(SYS_CTRL, 0xF);
+            count--;
+        }
+        if (count && span.right_mask != 0xF)
+        {
+            count--;
+        }
+
+        // every word has the same high byte, so only the low one is written
+        xm_setbh(DATA, (uint8_t)(word_value >> 8));
+        xb_fill_lo_loop(count, word_value & 0xff);
+
+        if (span.words > 1 && span.right_mask != 0xF)
+        {
+            xm_setbl(SYS_CTRL, span.right_mask);
+            xm_setw(DATA, word_value);
+            xm_setbl(SYS_CTRL, 0xF);
+        }
+
+        addr += vram_stride;
+    }
+}
+
+void xv_copy_rect_from_vram(uint16_t  vram_base,
+                            uint16_t  vram_stride,
+                            uint16_t  x,
+                            uint16_t  y,
+                            uint16_t  width,
+                            uint16_t  height,
+                            uint8_t   bpp,
+                            uint8_t * dest,
+                            uint32_t  dest_stride)
+{
+    xv_prep();
+
+    xv_rect_span span;
+    if (!rect_span(x, width, bpp, &span))
+    {
+        return;
+    }
+
+    uint16_t addr = vram_base + y * vram_stride + span.first;
+    xm_setw(RD_INCR, 1);
+
+    while (height--)
+    {
+        xm_setw(RD_ADDR, addr);
+
+        // straight in if it lines up, else via row_buf and shifted out
+        bool      direct = span.phase == 0 && !((uintptr_t)dest & 1) && span.row_bytes == span.words * 2u;
+        uint16_t * words = direct ? (uint16_t *)dest : row_buf;
+        uint16_t   count = span.words;
+
+        if (count & 1)
+        {
+            *words++ = xm_getw(DATA);
+        }
+        if ((count >> 1) >= XB_COPY_UNROLL_MIN)
+        {
+            xb_copy_from_l_unrolled((uint32_t *)words, count >> 1);
+        }
+        else
+        {
+            uint32_t * long_ptr = (uint32_t *)words;
+            for (uint16_t i = 0; i < (count >> 1); i++)
+            {
+                *long_ptr++ = xm_getl(DATA);
+            }
+        }
+
+        if (!direct)
+        {
+            // bytes start phase bits into the row (a nibble, for 4 bpp), so shift them out of a 32-bit window
+            uint8_t shift = span.phase;
+            for (uint32_t b = 0; b < span.row_bytes; b++)
+            {
+                uint32_t bit    = (uint32_t)b * 8 + shift;
+                uint32_t window = ((uint32_t)row_buf[bit >> 4] << 16) | row_buf[(bit >> 4) + 1];
+                dest[b]         = (uint8_t)(window >> (24 - (bit & 15)));
+            }
+        }
+
+        dest += dest_stride;
+        addr += vram_stride;
+    }
+}
+
 // define xosera_ptr in a way that GCC can't see the immediate const value (causing it to keep it in a register).
 __asm__(
     "               .data\n"
@@ -43,6 +43,35 @@ void xv_vram_fill(uint32_t vram_addr, uint32_t numwords, uint32_t word_value);
 void xv_copy_to_vram(uint16_t * source, uint32_t vram_dest, uint32_t numbytes);          // copy to VRAM
 void xv_copy_from_vram(uint32_t vram_source, uint16_t * dest, uint32_t numbytes);        // copy from VRAM
 
+// Rectangles: x and width are in pixels at bpp (1, 4, 8 or 16, with 1 bpp x and width multiples of 4), VRAM strides
+// are in words and RAM strides in bytes. RAM pixels are packed from the rectangle's left edge (no alignment needed).
+void xv_copy_rect(const uint8_t * source,
+                  uint32_t        source_stride,
+                  uint16_t        vram_base,
+                  uint16_t        vram_stride,
+                  uint16_t        x,
+                  uint16_t        y,
+                  uint16_t        width,
+                  uint16_t        height,
+                  uint8_t         bpp);        // copy rectangle to VRAM
+void xv_fill_rect(uint16_t vram_base,
+                  uint16_t vram_stride,
+                  uint16_t x,
+                  uint16_t y,
+                  uint16_t width,
+                  uint16_t height,
+                  uint8_t  bpp,
+                  uint16_t word_value);        // fill rectangle with word (pixel value repeated across it)
+void xv_copy_rect_from_vram(uint16_t  vram_base,
+                            uint16_t  vram_stride,
+                            uint16_t  x,
+                            uint16_t  y,
+                            uint16_t  width,
+                            uint16_t  height,
+                            uint8_t   bpp,
+                            uint8_t * dest,
+                            uint32_t  dest_stride);        // copy rectangle from VRAM
+
 // Low-level C API reference:
 //
 // set/get XM registers (main registers):
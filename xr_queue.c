@@ -0,0 +1,57 @@
+/*
+ * vim: set et ts=4 sw=4
+ *------------------------------------------------------------
+ *                                  ___ ___ _
+ *  ___ ___ ___ ___ ___       _____|  _| . | |_
+ * |  _| . |_ -|  _| . |     |     | . | . | '_|
+ * |_| |___|___|___|___|_____|_|_|_|___|___|_,_|
+ *                     |_____|
+ * ------------------------------------------------------------
+ * Copyright (c) 2021 Ross Bamford
+ * MIT License
+ *
+ * Deferred XR register writes, applied in the vblank handler
+ * ------------------------------------------------------------
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "xr_queue.h"
+
+volatile XrqEntry xrq_entries[XRQ_SIZE];
+volatile uint8_t xrq_head = 0;
+volatile uint8_t xrq_tail = 0;
+
+static uint8_t staged_head = 0;
+static uint32_t overflows = 0;
+
+bool xrq_stage(uint16_t xr_addr, uint16_t value) {
+    uint8_t next = (staged_head + 1) & XRQ_MASK;
+
+    if (next == xrq_tail) {
+        overflows++;
+        return false;
+    }
+
+    xrq_entries[staged_head].xr_addr = xr_addr;
+    xrq_entries[staged_head].value = value;
+    staged_head = next;
+
+    return true;
+}
+
+void xrq_commit() {
+    // Single byte write - the handler sees all of the batch or none of it
+    xrq_head = staged_head;
+}
+
+bool xrq_put(uint16_t xr_addr, uint16_t value) {
+    bool result = xrq_stage(xr_addr, value);
+    xrq_commit();
+    return result;
+}
+
+uint32_t xrq_overflows() {
+    return overflows;
+}
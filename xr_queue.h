@@ -0,0 +1,56 @@
+/*
+ * vim: set et ts=4 sw=4
+ *------------------------------------------------------------
+ *                                  ___ ___ _
+ *  ___ ___ ___ ___ ___       _____|  _| . | |_
+ * |  _| . |_ -|  _| . |     |     | . | . | '_|
+ * |_| |___|___|___|___|_____|_|_|_|___|___|_,_|
+ *                     |_____|
+ * ------------------------------------------------------------
+ * Copyright (c) 2021 Ross Bamford
+ * MIT License
+ *
+ * Deferred XR register writes, applied in the vblank handler
+ *
+ * Single producer (main loop), single consumer (vblank handler)
+ * ring buffer of XR address / value pairs. Writes are staged,
+ * then published all at once by xrq_commit(), so everything in
+ * a commit lands in the same vblank. Neither side ever needs to
+ * disable interrupts: the main loop only writes xrq_head, and
+ * the handler only writes xrq_tail.
+ * ------------------------------------------------------------
+ */
+
+#if !defined(XR_QUEUE_H)
+#define XR_QUEUE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// NOTE: Must match XRQ_MASK in interrupt.asm!
+#define XRQ_SIZE    64
+#define XRQ_MASK    (XRQ_SIZE - 1)
+
+typedef struct {
+    uint16_t    xr_addr;        // XR register number or XR memory address
+    uint16_t    value;
+} XrqEntry;
+
+// Shared with the vblank handler
+extern volatile XrqEntry xrq_entries[XRQ_SIZE];
+extern volatile uint8_t xrq_head;
+extern volatile uint8_t xrq_tail;
+
+// Stage a write for the next commit. Returns false if the queue is full.
+bool xrq_stage(uint16_t xr_addr, uint16_t value);
+
+// Publish everything staged so far, to be applied at the next vblank
+void xrq_commit();
+
+// Stage and commit a single write
+bool xrq_put(uint16_t xr_addr, uint16_t value);
+
+// Writes dropped because the queue was full
+uint32_t xrq_overflows();
+
+#endif